@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include "lexical_analysis.h"
+
+/**
+ * @brief Lexes many files in one process, on a pool of worker threads.
+ *
+ * Every worker lexes with its own copy of a configured LexicalAnalyzer, so the
+ * token arrays, spellings and scan cursors are per worker, while the tables of the
+ * CompiledDFA are shared read-only by all of them. Files are dealt to the workers
+ * in turn; a worker takes its files in order, and when it runs out it steals the
+ * last file of the worker that has the most left, so a few large files do not hold
+ * up the rest.
+ *
+ * The output of each file is produced by `format` on the worker, and written to
+ * the stream in the order of the input list as soon as every file before it is
+ * done, so the output is the same for any number of threads.
+ */
+class BatchLexer
+{
+    public:
+        // the output for one file; `status` is what analyze returned, and `text` the
+        // whole file if it could be mapped (SourceBuffer::contents)
+        using Format = std::function<std::string(const std::string &path, std::string_view text, LexicalAnalyzer &, int status)>;
+
+    private:
+        LexicalAnalyzer prototype;
+        unsigned num_threads;
+
+    public:
+        BatchLexer(const LexicalAnalyzer &, unsigned threads = 0);
+        int run(const std::vector<std::string> &paths, const Format &, std::ostream &);
+};
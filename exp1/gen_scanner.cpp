@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <fstream>
+#include "lexical_analysis.h"
+#include "my_dfa.h"
+
+/**
+ * @brief Writes a direct-coded scanner for `dfa`: a C++ function with one label per
+ *        state and a `switch` on the input byte, in the style of re2c.
+ *
+ * @details Every case of a state does what CompiledDFA::scan does for the table entry
+ *          of that byte: emit the token on ACCEPT, then step to the target state,
+ *          restart the token on START, or stop on FAIL. Bytes without a transition
+ *          fall into `default`, which reads a multibyte UTF-8 character there as the
+ *          table loop does if the state has a MULTIBYTE entry. Only comment bodies (UNTIL rules) are
+ *          skipped with ByteScanner; whitespace, identifier and number runs are short,
+ *          and the state's own switch loops over them faster than a call would. The
+ *          function is exported as the DirectScanner `name`, stamped with the
+ *          fingerprint of `dfa`, so it can only be attached to the same tables.
+ */
+static int generate(const CompiledDFA &dfa, const std::string &name, std::ostream &out)
+{
+    static const char *rule_names[] = {"NONE", "SPACE", "ALNUM", "DIGIT", "UNTIL"};
+    int num_states = dfa.get_num_states();
+
+    out << "static ScanCursor " << name << "_scan(const unsigned char *data, size_t end, ScanCursor cursor, DirectScanner::EmitFunction emit, void *context)\n";
+    out << "{\n";
+    out << "    size_t p = cursor.pos, start = cursor.token_start;\n";
+    out << "    uint16_t state;\n";
+    out << "    int width;\n";
+    out << "    switch(cursor.state){\n";
+    for(int i = 0; i < num_states; i ++){
+        out << "        case " << i << ": goto s" << i << ";\n";
+    }
+    out << "        default: goto s0;\n";
+    out << "    }\n";
+
+    // the code of a step of state i on `entry`, `advance` being the code that moves p
+    // past the character
+    auto step = [&](int i, uint16_t entry, const char *advance, const std::string &indent){
+        int target = entry & CompiledDFA::STATE_MASK;
+        if(entry & CompiledDFA::ACCEPT){
+            out << indent << "if(!emit(context, start, p, " << dfa.get_attr(i) << ")){\n";
+            out << indent << "    state = 0;\n";
+            out << indent << "    start = p;\n";
+            out << indent << "    goto done;\n";
+            out << indent << "}\n";
+            out << indent << "start = p;\n";
+        }
+        if(entry & CompiledDFA::FAIL){
+            out << indent << "cursor.status = ScanCursor::FAILED;\n";
+            out << indent << "cursor.error = " << dfa.get_attr(target) << ";\n";
+            out << indent << "state = " << target << ";\n";
+            out << indent << "goto done;\n";
+            return;
+        }
+        out << indent << advance << "\n";
+        if((entry & CompiledDFA::ACCEL) && dfa.get_scan_rule(target).kind == ScanRule::UNTIL){
+            const ScanRule &rule = dfa.get_scan_rule(target);
+            out << indent << "p = ByteScanner::skip(ScanRule{ScanRule::" << rule_names[rule.kind] << ", "
+                << (int)rule.c1 << ", " << (int)rule.c2 << "}, data + p, data + end) - data;\n";
+        }
+        if(entry & CompiledDFA::START){
+            out << indent << "start = p;\n";
+        }
+        out << indent << "goto s" << target << ";\n";
+    };
+
+    for(int i = 0; i < num_states; i ++){
+        // group the bytes of the state by table entry, in order of their first byte
+        std::vector<uint16_t> entries;
+        std::map<uint16_t, std::vector<int>> cases;
+        for(int b = 0; b < 256; b ++){
+            uint16_t entry = dfa.next(i, b);
+            if(entry == CompiledDFA::NO_TRANSITION){
+                continue;
+            }
+            if(!cases.count(entry)){
+                entries.push_back(entry);
+            }
+            cases[entry].push_back(b);
+        }
+
+        out << "s" << i << ":\n";
+        out << "    if(p == end){\n";
+        out << "        state = " << i << ";\n";
+        out << "        goto done;\n";
+        out << "    }\n";
+        out << "    switch(data[p]){\n";
+        for(uint16_t entry : entries){
+            out << "       ";
+            for(int b : cases[entry]){
+                out << " case " << b << ":";
+            }
+            out << "\n";
+            step(i, entry, "p ++;", "            ");
+        }
+        out << "        default:\n";
+        uint16_t multibyte = dfa.next_multibyte(i);
+        if(multibyte != CompiledDFA::NO_TRANSITION){
+            out << "            width = ByteScanner::utf8_length(data + p, data + end);\n";
+            out << "            if(width < 0){\n";
+            out << "                state = " << i << ";\n";
+            out << "                goto done;\n";
+            out << "            }\n";
+            out << "            if(width > 0){\n";
+            step(i, multibyte, "p += width;", "                ");
+            out << "            }\n";
+        }
+        out << "            cursor.status = ScanCursor::UNRECOGNIZED_SYMBOL;\n";
+        out << "            state = " << i << ";\n";
+        out << "            goto done;\n";
+        out << "    }\n";
+    }
+
+    out << "done:\n";
+    out << "    cursor.state = state;\n";
+    out << "    cursor.pos = p;\n";
+    out << "    cursor.token_start = start;\n";
+    out << "    return cursor;\n";
+    out << "}\n\n";
+    out << "extern const DirectScanner " << name << " = {" << name << "_scan, " << num_states << ", "
+        << dfa.get_num_classes() << ", " << dfa.get_fingerprint() << "u};\n";
+    return 0;
+}
+
+// writes `values` as the initializer of a static array `type name[]`, 16 to a line
+template<class T>
+static void write_array(const char *type, const std::string &name, const std::vector<T> &values, std::ostream &out)
+{
+    out << "static const " << type << " " << name << "[" << std::max<size_t>(values.size(), 1) << "] = {";
+    for(size_t k = 0; k < values.size(); k ++){
+        out << (k % 16 == 0 ? "\n    " : " ") << values[k] << (k + 1 < values.size() ? "," : "");
+    }
+    out << "\n};\n";
+}
+
+/**
+ * @brief Writes the arrays of `dfa` as static data, and a function `function` that
+ *        wraps them in a CompiledDFA (see static_dfa.h), so the binaries get the
+ *        tables without building them.
+ */
+static int generate_tables(const CompiledDFA &dfa, const std::string &name, const std::string &function, std::ostream &out)
+{
+    static const char *rule_names[] = {"NONE", "SPACE", "ALNUM", "DIGIT", "UNTIL"};
+    int num_states = dfa.get_num_states(), num_classes = dfa.get_num_classes();
+    std::vector<int> byte_class, attrs;
+    std::vector<uint16_t> table, inner_states;
+    std::vector<std::string> accel;
+    for(int b = 0; b <= CompiledDFA::MULTIBYTE; b ++){
+        byte_class.push_back(dfa.get_class(b));
+    }
+    for(int i = 0; i < num_states; i ++){
+        for(int c = 0; c < num_classes; c ++){
+            table.push_back(dfa.get_entry(i, c));
+        }
+        attrs.push_back(dfa.get_attr(i));
+        const ScanRule &rule = dfa.get_scan_rule(i);
+        accel.push_back(std::string("{ScanRule::") + rule_names[rule.kind] + ", " + std::to_string(rule.c1) + ", "
+            + std::to_string(rule.c2) + "}");
+    }
+    for(int k = 0; k < dfa.get_num_inner_states(); k ++){
+        inner_states.push_back(dfa.get_inner_state(k));
+    }
+
+    write_array("uint8_t", name + "_byte_class", byte_class, out);
+    write_array("uint16_t", name + "_table", table, out);
+    write_array("int", name + "_attrs", attrs, out);
+    write_array("ScanRule", name + "_accel", accel, out);
+    write_array("uint16_t", name + "_inner_states", inner_states, out);
+    out << "\n";
+    out << "CompiledDFA " << function << "()\n";
+    out << "{\n";
+    out << "    return CompiledDFA(" << name << "_byte_class, " << num_states << ", " << num_classes << ", " << name << "_table, "
+        << name << "_attrs, " << name << "_accel, " << name << "_inner_states, " << inner_states.size() << ");\n";
+    out << "}\n";
+    return 0;
+}
+
+/**
+ * @brief Writes the tables and scanners of both lexer DFAs: get_static_dfa() and
+ *        `lexer_direct_scanner` with keyword states, get_static_identifier_dfa() and
+ *        `identifier_direct_scanner` without them (see LexicalAnalyzer::set_keywords).
+ */
+static int generate_all(std::ostream &out)
+{
+    MakeDFA a, b;
+    CompiledDFA lexer = a.make_dfa().compile(), identifier = b.make_dfa(false).compile();
+    out << "// Generated by gen_scanner from the lexer DFAs of my_dfa.h. Do not edit.\n";
+    out << "#include \"static_dfa.h\"\n\n";
+    generate_tables(lexer, "lexer", "get_static_dfa", out);
+    out << "\n";
+    generate(lexer, "lexer_direct_scanner", out);
+    out << "\n";
+    generate_tables(identifier, "identifier", "get_static_identifier_dfa", out);
+    out << "\n";
+    generate(identifier, "identifier_direct_scanner", out);
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    // write to the file given on the command line, or stdout
+    if(argc > 1){
+        std::ofstream out(argv[1]);
+        if(!out){
+            std::cerr << "Cannot open " << argv[1] << "\n";
+            return 1;
+        }
+        generate_all(out);
+    }else{
+        generate_all(std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,322 @@
+#include "lexer_generator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static std::invalid_argument pattern_error(const std::string &pattern, size_t pos, const std::string &reason)
+{
+    return std::invalid_argument("Pattern \"" + pattern + "\", offset " + std::to_string(pos) + ": " + reason);
+}
+
+/**
+ * @brief Creates a generator over the given symbols, which become the symbols of the
+ *        DFA in the same order.
+ *
+ * @param alphabet      Single-character symbols, and optionally InputSymbol::MULTIBYTE;
+ *                      patterns may only use these.
+ * @param default_error The error code of a token that stops before any rule completes.
+ *
+ * @throws std::invalid_argument If a symbol is not one character or is repeated.
+ */
+LexerGenerator::LexerGenerator(const std::vector<InputSymbol> &alphabet, int default_error) :
+    alphabet(alphabet), default_error(default_error)
+{
+    symbol_index.fill(-1);
+    for(int j = 0; j < alphabet.size(); j ++){
+        std::string value = alphabet[j].get_value();
+        int ch = value == InputSymbol::MULTIBYTE ? MULTIBYTE : (unsigned char)value[0];
+        if((value.size() != 1 && ch != MULTIBYTE) || symbol_index[ch] >= 0){
+            throw std::invalid_argument("LexerGenerator needs distinct single-character symbols");
+        }
+        symbol_index[ch] = j;
+    }
+}
+
+int LexerGenerator::new_state()
+{
+    nfa.push_back(NFAState());
+    return nfa.size() - 1;
+}
+
+// reads a character, resolving an escape; `\u` is MULTIBYTE
+int LexerGenerator::parse_char(const std::string &pattern, size_t &pos) const
+{
+    unsigned char ch = pattern[pos ++];
+    if(ch == '\\'){
+        if(pos == pattern.size()){
+            throw pattern_error(pattern, pos, "escape at the end");
+        }
+        ch = pattern[pos ++];
+        if(ch == 'u'){
+            return MULTIBYTE;
+        }
+        ch = ch == 'n' ? '\n' : (ch == 't' ? '\t' : (ch == 'r' ? '\r' : ch));
+    }
+    return ch;
+}
+
+// reads a character and returns its symbol
+int LexerGenerator::parse_symbol(const std::string &pattern, size_t &pos) const
+{
+    size_t at = pos;
+    int symbol = symbol_index[parse_char(pattern, pos)];
+    if(symbol < 0){
+        throw pattern_error(pattern, at, "character is not in the alphabet");
+    }
+    return symbol;
+}
+
+// reads a class after its '[', up to and including the ']'
+std::vector<bool> LexerGenerator::parse_class(const std::string &pattern, size_t &pos) const
+{
+    std::vector<bool> set(alphabet.size());
+    bool negate = pos < pattern.size() && pattern[pos] == '^';
+    pos += negate;
+    while(pos < pattern.size() && pattern[pos] != ']'){
+        size_t at = pos;
+        int low = parse_char(pattern, pos), high = low;
+        if(pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']'){
+            pos ++;
+            high = parse_char(pattern, pos);
+            if(low > high){
+                throw pattern_error(pattern, at, "empty range");
+            }
+        }else if(symbol_index[low] < 0){
+            throw pattern_error(pattern, at, "character is not in the alphabet");
+        }
+        for(int ch = low; ch <= high; ch ++){
+            if(symbol_index[ch] >= 0){
+                set[symbol_index[ch]] = true;
+            }
+        }
+    }
+    if(pos == pattern.size()){
+        throw pattern_error(pattern, pos, "missing ']'");
+    }
+    pos ++;
+    if(negate){
+        set.flip();
+    }
+    return set;
+}
+
+std::pair<int, int> LexerGenerator::parse_atom(const std::string &pattern, size_t &pos)
+{
+    char ch = pattern[pos];
+    if(ch == '('){
+        pos ++;
+        auto fragment = parse_alternative(pattern, pos);
+        if(pos == pattern.size() || pattern[pos] != ')'){
+            throw pattern_error(pattern, pos, "missing ')'");
+        }
+        pos ++;
+        return fragment;
+    }
+    if(ch == '*' || ch == '+' || ch == '?'){
+        throw pattern_error(pattern, pos, "nothing to repeat");
+    }
+    std::vector<bool> set(alphabet.size(), ch == '.');
+    if(ch == '['){
+        pos ++;
+        set = parse_class(pattern, pos);
+    }else if(ch == '.'){
+        pos ++;
+    }else{
+        set[parse_symbol(pattern, pos)] = true;
+    }
+    int start = new_state(), end = new_state();
+    for(int j = 0; j < alphabet.size(); j ++){
+        if(set[j]){
+            nfa[start].edges.push_back({j, end});
+        }
+    }
+    if(nfa[start].edges.empty()){
+        throw pattern_error(pattern, pos, "class matches no symbol");
+    }
+    return {start, end};
+}
+
+std::pair<int, int> LexerGenerator::parse_repeat(const std::string &pattern, size_t &pos)
+{
+    auto [first, last] = parse_atom(pattern, pos);
+    while(pos < pattern.size() && (pattern[pos] == '*' || pattern[pos] == '+' || pattern[pos] == '?')){
+        char op = pattern[pos ++];
+        int start = new_state(), end = new_state();
+        nfa[start].edges.push_back({EPSILON, first});
+        nfa[last].edges.push_back({EPSILON, end});
+        if(op != '?'){
+            nfa[last].edges.push_back({EPSILON, first});
+        }
+        if(op != '+'){
+            nfa[start].edges.push_back({EPSILON, end});
+        }
+        first = start;
+        last = end;
+    }
+    return {first, last};
+}
+
+std::pair<int, int> LexerGenerator::parse_sequence(const std::string &pattern, size_t &pos)
+{
+    int start = new_state(), end = start;
+    while(pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')'){
+        auto [first, last] = parse_repeat(pattern, pos);
+        nfa[end].edges.push_back({EPSILON, first});
+        end = last;
+    }
+    return {start, end};
+}
+
+std::pair<int, int> LexerGenerator::parse_alternative(const std::string &pattern, size_t &pos)
+{
+    auto fragment = parse_sequence(pattern, pos);
+    if(pos == pattern.size() || pattern[pos] != '|'){
+        return fragment;
+    }
+    int start = new_state(), end = new_state();
+    nfa[start].edges.push_back({EPSILON, fragment.first});
+    nfa[fragment.second].edges.push_back({EPSILON, end});
+    while(pos < pattern.size() && pattern[pos] == '|'){
+        pos ++;
+        auto [first, last] = parse_sequence(pattern, pos);
+        nfa[start].edges.push_back({EPSILON, first});
+        nfa[last].edges.push_back({EPSILON, end});
+    }
+    return {start, end};
+}
+
+/**
+ * @brief Adds a rule. Rules added earlier win over later ones of the same priority.
+ *
+ * @throws std::invalid_argument If the pattern is malformed, uses a character that is
+ *         not in the alphabet, or matches the empty string.
+ */
+int LexerGenerator::add_rule(const LexRule &rule)
+{
+    size_t pos = 0;
+    auto [start, end] = parse_alternative(rule.pattern, pos);
+    if(pos != rule.pattern.size()){
+        throw pattern_error(rule.pattern, pos, "unbalanced ')'");
+    }
+    std::vector<int> reached{start};
+    closure(reached);
+    if(std::binary_search(reached.begin(), reached.end(), end)){
+        throw pattern_error(rule.pattern, 0, "matches the empty string");
+    }
+    nfa[end].rule = rules.size();
+    rules.push_back(rule);
+    starts.push_back(start);
+    return 0;
+}
+
+// extends a set of NFA states with everything reachable by epsilon edges, and sorts it
+int LexerGenerator::closure(std::vector<int> &set) const
+{
+    std::vector<bool> in(nfa.size());
+    for(int s : set){
+        in[s] = true;
+    }
+    for(int k = 0; k < set.size(); k ++){
+        for(auto [symbol, next] : nfa[set[k]].edges){
+            if(symbol == EPSILON && !in[next]){
+                in[next] = true;
+                set.push_back(next);
+            }
+        }
+    }
+    std::sort(set.begin(), set.end());
+    return 0;
+}
+
+// the best rule completed in a set of NFA states, or -1
+int LexerGenerator::best_rule(const std::vector<int> &set) const
+{
+    int best = -1;
+    for(int s : set){
+        int r = nfa[s].rule;
+        if(r >= 0 && (best < 0 || rules[r].priority > rules[best].priority
+            || (rules[r].priority == rules[best].priority && r < best))){
+            best = r;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Builds the DFA of the rules added so far, by the subset construction.
+ *
+ * @return A DFA whose state 0 is the START state, with one OK state per token kind and
+ *         one FAIL state per error code, not yet minimized. As in every lexer DFA, the
+ *         rows of OK and FAIL states point back to the start state.
+ *
+ * @throws std::out_of_range If the DFA would have more than DFA::MAX_STATES states.
+ */
+DFA LexerGenerator::build() const
+{
+    int num_symbols = alphabet.size();
+    std::vector<State> states{State(0, State::START)};
+    std::vector<std::vector<int>> sets{starts};
+    closure(sets[0]);
+    std::map<std::vector<int>, int> index{{sets[0], 0}};
+    std::map<std::pair<int, int>, int> terminals;
+    std::vector<std::vector<int>> rows;
+
+    auto add_state = [&](const State &state, std::vector<int> set){
+        if(states.size() == DFA::MAX_STATES){
+            throw std::out_of_range("Lexer DFA has too many states");
+        }
+        states.push_back(State(states.size(), state.get_type(), state.get_attr()));
+        sets.push_back(std::move(set));
+        return (int)states.size() - 1;
+    };
+    auto terminal = [&](int type, int attr){
+        auto it = terminals.find({type, attr});
+        if(it == terminals.end()){
+            it = terminals.emplace(std::make_pair(type, attr), add_state(State(0, type, attr), {})).first;
+        }
+        return it->second;
+    };
+
+    for(int k = 0; k < states.size(); k ++){
+        rows.push_back(std::vector<int>(num_symbols, 0));
+        if(states[k].get_type() == State::OK || states[k].get_type() == State::FAIL){
+            continue;
+        }
+        for(int j = 0; j < num_symbols; j ++){
+            std::vector<int> next;
+            for(int s : sets[k]){
+                for(auto [symbol, target] : nfa[s].edges){
+                    if(symbol == j){
+                        next.push_back(target);
+                    }
+                }
+            }
+            closure(next);
+            int r = best_rule(next);
+            int target;
+            if(r >= 0 && rules[r].action == LexRule::ERROR){
+                target = terminal(State::FAIL, rules[r].attr);
+            }else if(r >= 0 && rules[r].action == LexRule::SKIP){
+                target = 0;
+            }else if(!next.empty()){
+                auto it = index.find(next);
+                if(it == index.end()){
+                    it = index.emplace(next, add_state(State(), next)).first;
+                }
+                target = it->second;
+            }else{
+                r = best_rule(sets[k]);
+                target = r >= 0 ? terminal(State::OK, rules[r].attr) : terminal(State::FAIL, default_error);
+            }
+            rows[k][j] = target;
+        }
+    }
+
+    std::vector<uint16_t> transition_function(states.size() * num_symbols);
+    for(int i = 0; i < states.size(); i ++){
+        for(int j = 0; j < num_symbols; j ++){
+            transition_function[i * num_symbols + j] = rows[i][j];
+        }
+    }
+    return DFA(states, alphabet, transition_function);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "lexical_analysis.h"
+
+/**
+ * @brief One rule of a lexer specification: text that matches `pattern` is a token of
+ *        kind `attr`, an error with code `attr`, or skipped.
+ *
+ * Patterns are regular expressions over single characters: literals, `\` escapes
+ * (`\n`, `\t`, `\r`, `\u` for any multibyte UTF-8 character, or any other character
+ * taken literally), `.` for any symbol, classes `[a-z_]` and `[^...]`, grouping, `|`,
+ * `*`, `+` and `?`. A negated class and `.` only stand for the symbols of the
+ * generator's alphabet, so they include `\u` if the alphabet has InputSymbol::MULTIBYTE.
+ */
+struct LexRule
+{
+    enum { TOKEN, ERROR, SKIP };
+
+    std::string pattern;
+    int action = TOKEN;
+    int attr = 0;               // token kind, or error code
+    int priority = 0;           // the highest wins when rules match the same text
+};
+
+/**
+ * @brief Builds the lexer DFA from a list of LexRules: every pattern becomes an NFA by
+ *        Thompson's construction, and the union of them is made deterministic by the
+ *        subset construction. The result is an ordinary DFA, to be minimized and
+ *        compiled like any other.
+ *
+ * The DFA follows the lexer's one-byte lookahead: a token is as long as possible, and
+ * it ends on the first byte that no rule can continue with, which then starts the
+ * next token. Precisely, from a set S of NFA states on symbol c, with T the states
+ * reached from S on c:
+ *   - if the best rule that T completes is an ERROR, the DFA fails with its code at
+ *     c, and if it is a SKIP, the DFA goes back to the start state;
+ *   - otherwise, if T is not empty, the DFA goes on to T;
+ *   - otherwise the token ends with the kind of the best rule that S completes (an
+ *     OK state), or, if S completes none, the DFA fails with `default_error`.
+ * The best rule is the one of highest priority, and of those the first one added.
+ */
+class LexerGenerator
+{
+    private:
+        struct NFAState
+        {
+            int rule = -1;                              // rule completed here
+            std::vector<std::pair<int, int>> edges;     // symbol (EPSILON) and target
+        };
+        static constexpr int EPSILON = -1;
+        static constexpr int MULTIBYTE = 256;          // the character code of `\u`
+
+        std::vector<InputSymbol> alphabet;
+        std::array<int, MULTIBYTE + 1> symbol_index;    // by character code
+        int default_error;
+        std::vector<LexRule> rules;
+        std::vector<NFAState> nfa;
+        std::vector<int> starts;
+
+        int new_state();
+        int parse_char(const std::string &, size_t &) const;
+        int parse_symbol(const std::string &, size_t &) const;
+        std::vector<bool> parse_class(const std::string &, size_t &) const;
+        std::pair<int, int> parse_atom(const std::string &, size_t &);
+        std::pair<int, int> parse_repeat(const std::string &, size_t &);
+        std::pair<int, int> parse_sequence(const std::string &, size_t &);
+        std::pair<int, int> parse_alternative(const std::string &, size_t &);
+        int closure(std::vector<int> &) const;
+        int best_rule(const std::vector<int> &) const;
+
+    public:
+        LexerGenerator(const std::vector<InputSymbol> &alphabet, int default_error);
+        int add_rule(const LexRule &);
+        DFA build() const;
+};
@@ -1,4 +1,7 @@
 #include "lexical_analysis.h"
+#include "source_buffer.h"
+#include <algorithm>
+#include <thread>
 
 // Class State  
 State::State(int id, int type, int attr)
@@ -33,22 +36,22 @@ bool State::operator<(const State &other) const
     return id < other.id;
 }
   
-// Class Symbol  
-Symbol::Symbol(std::string value) : value{value} {}
+// Class InputSymbol  
+InputSymbol::InputSymbol(std::string value) : value{value} {}
 
-Symbol::Symbol(char value) : value{value} {}
+InputSymbol::InputSymbol(char value) : value{value} {}
 
-std::string Symbol::get_value() const
+std::string InputSymbol::get_value() const
 {
     return this->value;
 }  
 
-bool Symbol::operator==(const Symbol &other) const
+bool InputSymbol::operator==(const InputSymbol &other) const
 {
     return value == other.value;
 }
 
-bool Symbol::operator<(const Symbol &other) const
+bool InputSymbol::operator<(const InputSymbol &other) const
 {
     return value < other.value;
 }
@@ -62,7 +65,7 @@ bool Symbol::operator<(const Symbol &other) const
  * @param states A vector of State objects representing the states of the DFA.
  *               The first state must be of type START, and no other state should be of type START.
  *               All states must be unique.
- * @param symbols A vector of Symbol objects representing the input symbols the DFA can process.
+ * @param symbols A vector of InputSymbol objects representing the input symbols the DFA can process.
  *                All symbols must be unique.
  * @param transitions A 2D vector of State objects representing the transition function.
  *                    transitions[i][j] represents the state transitioned to from state i on input symbol j.
@@ -72,11 +75,47 @@ bool Symbol::operator<(const Symbol &other) const
  * 
  * @throws std::invalid_argument If any of the validation checks fail, an invalid_argument exception is thrown with an appropriate error message.
  */
-DFA::DFA(std::vector<State> states, std::vector<Symbol> symbols, std::vector<std::vector<State>> transitions)
+DFA::DFA(std::vector<State> states, std::vector<InputSymbol> symbols, std::vector<std::vector<State>> transitions)
+    : DFA(states, symbols, std::vector<uint16_t>())
+{
+    // the delegated constructor checked the states, so only the transitions are left
+    std::map<State, int> index;
+    for(int i = 0; i < states.size(); i ++){
+        index[states[i]] = i;
+    }
+    if(transitions.size() != states.size()){
+        throw std::invalid_argument("DFA transition function must have the same size as number of states");
+    }
+    for(int i = 0; i < transitions.size(); i++){
+        if(transitions[i].size() != symbols.size()){
+            throw std::invalid_argument("DFA transition function must have the same size as number of symbols");
+        }
+        for(int j = 0; j < transitions[i].size(); j++){
+            if(!index.count(transitions[i][j])){
+                throw std::invalid_argument("DFA transition function must have only states from DFA");
+            }
+            this->transitions[i * symbols.size() + j] = index[transitions[i][j]];
+        }
+    }
+}
+
+/**
+ * @brief Constructs a DFA from state indexes: transitions[i * symbols.size() + j] is
+ *        the index of the state reached from state i on symbol j. An empty
+ *        `transitions` leaves every transition at state 0.
+ *
+ * @throws std::invalid_argument As the constructor above, or if there are more than
+ *         MAX_STATES states.
+ */
+DFA::DFA(std::vector<State> states, std::vector<InputSymbol> symbols, std::vector<uint16_t> transitions)
+    : state_list(states), symbol_list(symbols)
 {
     if(states.empty()){
         throw std::invalid_argument("DFA must have at least 1 states");
     }
+    if(states.size() > MAX_STATES){
+        throw std::invalid_argument("DFA supports at most " + std::to_string(MAX_STATES) + " states");
+    }
     if(states[0].get_type() != State::START){
         throw std::invalid_argument("DFA 0 state must be of type START");
     }
@@ -85,12 +124,10 @@ DFA::DFA(std::vector<State> states, std::vector<Symbol> symbols, std::vector<std
             throw std::invalid_argument("DFA >= 1 state must be of type GENERAL");
         }
     }
-    for(int i = 0; i < states.size(); i++){
-        if(this->states.count(states[i])){
-            throw std::invalid_argument("DFA must have unique states");
-        }else{
-            this->states[states[i]] = i;
-        }
+    std::vector<State> sorted = states;
+    std::sort(sorted.begin(), sorted.end());
+    if(std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()){
+        throw std::invalid_argument("DFA must have unique states");
     }
     for(int i = 0; i < symbols.size(); i++){
         if(this->symbols.count(symbols[i])){
@@ -99,126 +136,943 @@ DFA::DFA(std::vector<State> states, std::vector<Symbol> symbols, std::vector<std
             this->symbols[symbols[i]] = i;
         }
     }
-    if(transitions.size() != states.size()){
-        throw std::invalid_argument("DFA transition function must have the same size as number of states");
+    if(transitions.empty()){
+        transitions.assign(states.size() * symbols.size(), 0);
     }
-    for(int i = 0; i < transitions.size(); i++){
-        if(transitions[i].size() != symbols.size()){
-            throw std::invalid_argument("DFA transition function must have the same size as number of symbols");
+    if(transitions.size() != states.size() * symbols.size()){
+        throw std::invalid_argument("DFA transition function must have the same size as number of states times number of symbols");
+    }
+    for(auto next : transitions){
+        if(next >= states.size()){
+            throw std::invalid_argument("DFA transition function must have only states from DFA");
         }
-        for(int j = 0; j < transitions[i].size(); j++){
-            if(!this->states.count(transitions[i][j])){
-                throw std::invalid_argument("DFA transition function must have only states from DFA");
+    }
+    this->transitions = std::move(transitions);
+}
+
+/**
+ * @brief Returns the state reached from `state` on `symbol`, or -1 if `symbol` is not
+ *        a symbol of the DFA.
+ */
+int DFA::next_state(int state, const InputSymbol &symbol) const
+{
+    auto it = this->symbols.find(symbol);
+    if(it == this->symbols.end()){
+        return -1;
+    }
+    return next(state, it->second);
+}
+
+const State &DFA::get_state(int state) const
+{
+    return this->state_list[state];
+}
+
+int DFA::get_num_states() const
+{
+    return this->state_list.size();
+}
+
+int DFA::get_num_symbols() const
+{
+    return this->symbol_list.size();
+}
+
+/**
+ * @brief Builds the minimal DFA that tokenizes every input the same way as this one.
+ *
+ * @return A DFA whose states are the equivalence classes of the reachable states of
+ *         this DFA, numbered in breadth-first order from the start state (index 0)
+ *         over the symbols in order. Two DFAs over the same symbols that tokenize the
+ *         same way therefore minimize to the same DFA, however they were built.
+ *
+ * @details Uses Hopcroft's partition refinement. The initial partition keeps the start
+ *          state on its own, puts all GENERAL states together, and groups OK and FAIL
+ *          states by attribute, so every accepting state keeps the token kind and every
+ *          failing state keeps the error it reports. The lexer never follows a
+ *          transition out of an OK or FAIL state (it restarts from START instead), so
+ *          those rows are ignored when refining, two such states with the same
+ *          attribute are always merged, and in the result their rows point to start.
+ */
+DFA DFA::minimize() const
+{
+    int num_states = state_list.size(), num_symbols = symbol_list.size();
+    auto terminal = [&](int i){
+        return state_list[i].get_type() == State::OK || state_list[i].get_type() == State::FAIL;
+    };
+
+    // drop unreachable states
+    std::vector<bool> reachable(num_states);
+    std::vector<int> order{0};
+    reachable[0] = true;
+    for(int k = 0; k < order.size(); k ++){
+        int i = order[k];
+        if(terminal(i)){
+            continue;
+        }
+        for(int j = 0; j < num_symbols; j ++){
+            int next = this->next(i, j);
+            if(!reachable[next]){
+                reachable[next] = true;
+                order.push_back(next);
+            }
+        }
+    }
+
+    // inverse transitions, without the rows of OK and FAIL states
+    std::vector<std::vector<std::vector<int>>> inverse(num_symbols, std::vector<std::vector<int>>(num_states));
+    for(int i = 0; i < num_states; i ++){
+        if(reachable[i] && !terminal(i)){
+            for(int j = 0; j < num_symbols; j ++){
+                inverse[j][next(i, j)].push_back(i);
             }
         }
     }
-    this->transition_function = transitions;
-    this->current_state = states[0];
+
+    // initial partition
+    std::vector<int> block(num_states, -1);
+    std::vector<std::vector<int>> blocks;
+    std::map<std::pair<int, int>, int> initial;
+    for(int i = 0; i < num_states; i ++){
+        if(!reachable[i]){
+            continue;
+        }
+        std::pair<int, int> key{state_list[i].get_type(), state_list[i].get_attr()};
+        if(i == 0){
+            key = {-1, 0};
+        }else if(!terminal(i)){
+            key = {State::GENERAL, 0};
+        }
+        auto [it, inserted] = initial.emplace(key, blocks.size());
+        if(inserted){
+            blocks.push_back({});
+        }
+        block[i] = it->second;
+        blocks[it->second].push_back(i);
+    }
+
+    // refine until every block is closed under the inverse transitions
+    std::vector<int> worklist;
+    std::vector<bool> queued(blocks.size(), true);
+    for(int b = 0; b < blocks.size(); b ++){
+        worklist.push_back(b);
+    }
+    while(!worklist.empty()){
+        int splitter = worklist.back();
+        worklist.pop_back();
+        queued[splitter] = false;
+        std::vector<int> members = blocks[splitter];
+        for(int j = 0; j < num_symbols; j ++){
+            std::map<int, std::vector<int>> marked;
+            for(int t : members){
+                for(int s : inverse[j][t]){
+                    marked[block[s]].push_back(s);
+                }
+            }
+            for(auto &[b, in] : marked){
+                if(in.size() == blocks[b].size()){
+                    continue;
+                }
+                // split `b` into the states that reach the splitter on j and the rest
+                std::vector<bool> is_in(num_states);
+                for(int s : in){
+                    is_in[s] = true;
+                }
+                std::vector<int> out;
+                for(int s : blocks[b]){
+                    if(!is_in[s]){
+                        out.push_back(s);
+                    }
+                }
+                int nb = blocks.size();
+                blocks[b] = in;
+                blocks.push_back(out);
+                queued.push_back(false);
+                for(int s : out){
+                    block[s] = nb;
+                }
+                if(queued[b]){
+                    worklist.push_back(nb);
+                    queued[nb] = true;
+                }else{
+                    int smaller = in.size() <= out.size() ? b : nb;
+                    worklist.push_back(smaller);
+                    queued[smaller] = true;
+                }
+            }
+        }
+    }
+
+    // number the blocks in breadth-first order from the start state, which only depends
+    // on what the DFA does and not on how its states were numbered, and build the quotient DFA
+    std::vector<int> renumber(blocks.size(), -1);
+    std::vector<int> representative{0};
+    renumber[block[0]] = 0;
+    for(int k = 0; k < representative.size(); k ++){
+        int i = representative[k];
+        for(int j = 0; j < num_symbols && !terminal(i); j ++){
+            int b = block[next(i, j)];
+            if(renumber[b] < 0){
+                renumber[b] = representative.size();
+                representative.push_back(blocks[b][0]);
+            }
+        }
+    }
+    std::vector<State> new_states;
+    for(int k = 0; k < representative.size(); k ++){
+        auto &state = state_list[representative[k]];
+        new_states.push_back(State(k, state.get_type(), state.get_attr()));
+    }
+    std::vector<uint16_t> new_transitions(representative.size() * num_symbols);
+    for(int k = 0; k < representative.size(); k ++){
+        int i = representative[k];
+        // rows of OK and FAIL states are never followed, they point back to start
+        for(int j = 0; j < num_symbols && !terminal(i); j ++){
+            new_transitions[k * num_symbols + j] = renumber[block[next(i, j)]];
+        }
+    }
+    return DFA(new_states, symbol_list, new_transitions);
 }
 
-int DFA::reset()
+/**
+ * @brief Flattens the DFA into the byte-indexed table used by the lexer.
+ *
+ * @return A CompiledDFA with the same states, in the same order, as this DFA.
+ *
+ * @see CompiledDFA::CompiledDFA
+ */
+CompiledDFA DFA::compile() const
 {
-    this->current_state = states[0];
-    return 0;
+    return CompiledDFA(state_list, symbol_list, transitions);
 }
 
-int DFA::go_next_state(Symbol symbol)
+// Class CompiledDFA
+struct CompiledDFA::Storage
 {
-    if(!this->symbols.count(symbol)){
-        return -1;
+    std::array<uint8_t, MULTIBYTE + 1> byte_class{};
+    std::vector<uint16_t> table;
+    std::vector<int> attrs;
+    std::vector<ScanRule> accel;
+    std::vector<uint16_t> inner_states;
+};
+
+// an empty DFA: every byte maps to class 0, which has no transition
+static const std::array<uint8_t, CompiledDFA::MULTIBYTE + 1> unknown_bytes{};
+static const uint16_t no_transitions[1] = {CompiledDFA::NO_TRANSITION};
+
+CompiledDFA::CompiledDFA() : CompiledDFA(unknown_bytes.data(), 0, 1, no_transitions, nullptr, nullptr, nullptr, 0) {}
+
+/**
+ * @brief Wraps tables that are already in compiled form, without copying them.
+ *
+ * @details The arrays must outlive every copy of this object; this is meant for tables
+ *          in static storage, such as the ones generated at build time (see static_dfa.h).
+ */
+CompiledDFA::CompiledDFA(const uint8_t *byte_class, int num_states, int num_classes, const uint16_t *table, const int *attrs,
+    const ScanRule *accel, const uint16_t *inner_states, int num_inner_states)
+    : byte_class(byte_class), num_states(num_states), num_classes(num_classes), num_inner_states(num_inner_states),
+      table(table), attrs(attrs), accel(accel), inner_states(inner_states), direct_scan(nullptr) {}
+
+/**
+ * @brief Builds the flat transition table from an index-based DFA description.
+ *
+ * @param states      The DFA states; the index of a state is its row in the table.
+ * @param symbols     The input symbols. Only single-byte symbols are reachable from
+ *                    `next`, and InputSymbol::MULTIBYTE from `next_multibyte`; bytes that
+ *                    are not a symbol map to class 0, whose entries are all
+ *                    NO_TRANSITION, and so do multibyte characters if the DFA does
+ *                    not have that symbol.
+ * @param transitions transitions[i * symbols.size() + j] is the index of the state
+ *                    reached from state i on symbol j, as in DFA.
+ *
+ * @details In the DFA a token ends by stepping on the byte after it into an OK state,
+ *          after which that byte is read again from the start state. The table folds
+ *          the two steps into one: such an entry is flagged ACCEPT and holds the entry
+ *          of the start state for the same byte, and the kind of the token becomes
+ *          the attribute of the state it ends in. OK states are then never entered
+ *          and are left out, the other states keeping their order.
+ *
+ *          Symbols whose columns are identical in every state are merged into a
+ *          single class, so the table only has as many columns as the DFA can
+ *          actually distinguish (letters that never start a keyword, for example,
+ *          all share one column). States get their ScanRule from match_scan_rule,
+ *          and every transition into a state with a rule is flagged ACCEL.
+ *
+ * @throws std::invalid_argument If the DFA has more states than fit in STATE_MASK, a
+ *         state ends tokens of two kinds, or the start state itself steps into an OK
+ *         state on a byte that ends a token.
+ */
+CompiledDFA::CompiledDFA(const std::vector<State> &states, const std::vector<InputSymbol> &symbols, const std::vector<uint16_t> &transitions)
+{
+    auto next = [&](int i, int j){
+        return transitions[i * symbols.size() + j];
+    };
+    // renumber the states without the OK states
+    std::vector<int> row(states.size(), -1);
+    int num_states = 0;
+    for(int i = 0; i < states.size(); i ++){
+        if(states[i].get_type() != State::OK){
+            row[i] = num_states ++;
+        }
     }
-    this->current_state = this->transition_function[this->states[this->current_state]][this->symbols[symbol]];
-    return 0;
+    if(num_states > MAX_STATES){
+        throw std::invalid_argument("CompiledDFA supports at most " + std::to_string(MAX_STATES) + " states");
+    }
+    auto owned = std::make_shared<Storage>();
+    auto encode = [&](int idx){
+        uint16_t entry = row[idx];
+        switch(states[idx].get_type()){
+            case State::FAIL: entry |= FAIL; break;
+            case State::START: entry |= START; break;
+        }
+        return entry;
+    };
+
+    // the attribute of a state is the kind of the tokens that end in it, or its error
+    owned->attrs.assign(num_states, 0);
+    std::vector<bool> accepts(num_states);
+    for(int i = 0; i < states.size(); i ++){
+        if(row[i] < 0){
+            continue;
+        }
+        owned->attrs[row[i]] = states[i].get_attr();
+        for(int j = 0; j < symbols.size(); j ++){
+            const State &target = states[next(i, j)];
+            if(target.get_type() != State::OK){
+                continue;
+            }
+            if(accepts[row[i]] && owned->attrs[row[i]] != target.get_attr()){
+                throw std::invalid_argument("CompiledDFA state " + std::to_string(i) + " ends tokens of two kinds");
+            }
+            if(states[next(0, j)].get_type() == State::OK){
+                throw std::invalid_argument("CompiledDFA start state accepts an empty token");
+            }
+            accepts[row[i]] = true;
+            owned->attrs[row[i]] = target.get_attr();
+        }
+    }
+
+    // group single-byte symbols by their column, class 0 is reserved for unknown bytes
+    std::map<std::vector<uint16_t>, int> columns;
+    columns[std::vector<uint16_t>(num_states, NO_TRANSITION)] = 0;
+    std::vector<const std::vector<uint16_t> *> class_columns{&columns.begin()->first};
+    for(int j = 0; j < symbols.size(); j ++){
+        std::string value = symbols[j].get_value();
+        bool multibyte = value == InputSymbol::MULTIBYTE;
+        if(value.size() != 1 && !multibyte){
+            continue;
+        }
+        std::vector<uint16_t> column(num_states);
+        for(int i = 0; i < states.size(); i ++){
+            if(row[i] < 0){
+                continue;
+            }
+            int target = next(i, j);
+            column[row[i]] = states[target].get_type() == State::OK ? ACCEPT | encode(next(0, j)) : encode(target);
+        }
+        auto [it, inserted] = columns.emplace(column, class_columns.size());
+        if(inserted){
+            class_columns.push_back(&it->first);
+        }
+        owned->byte_class[multibyte ? MULTIBYTE : (unsigned char)value[0]] = it->second;
+    }
+
+    int num_classes = class_columns.size();
+    auto &table = owned->table;
+    table.assign(num_states * num_classes, NO_TRANSITION);
+    for(int c = 0; c < num_classes; c ++){
+        for(int i = 0; i < num_states; i ++){
+            table[i * num_classes + c] = (*class_columns[c])[i];
+        }
+    }
+
+    // scan rules, from the bytes on which each state stays in itself
+    for(int i = 0; i < num_states; i ++){
+        std::array<bool, 256> stay;
+        for(int b = 0; b < 256; b ++){
+            uint16_t entry = table[i * num_classes + owned->byte_class[b]];
+            stay[b] = entry != NO_TRANSITION && !(entry & (ACCEPT | FAIL)) && (entry & STATE_MASK) == i;
+        }
+        owned->accel.push_back(match_scan_rule(stay));
+    }
+    for(auto &entry : table){
+        if(entry != NO_TRANSITION && owned->accel[entry & STATE_MASK].kind != ScanRule::NONE){
+            entry |= ACCEL;
+        }
+    }
+
+    // inner states: targets of transitions that do not fail or stay in START
+    std::vector<bool> inner(num_states);
+    for(auto entry : table){
+        if(entry != NO_TRANSITION && !(entry & (FAIL | START))){
+            inner[entry & STATE_MASK] = true;
+        }
+    }
+    for(int i = 0; i < num_states; i ++){
+        if(inner[i]){
+            owned->inner_states.push_back(i);
+        }
+    }
+
+    *this = CompiledDFA(owned->byte_class.data(), num_states, num_classes, table.data(), owned->attrs.data(),
+        owned->accel.data(), owned->inner_states.data(), owned->inner_states.size());
+    storage = owned;
+}
+
+int CompiledDFA::get_num_states() const
+{
+    return this->num_states;
+}
+
+int CompiledDFA::get_num_classes() const
+{
+    return this->num_classes;
+}
+
+/**
+ * @brief The inner states are the states a scan can be in between two bytes of a
+ *        token: the targets of transitions that do not fail or stay in START.
+ */
+int CompiledDFA::get_num_inner_states() const
+{
+    return this->num_inner_states;
+}
+
+uint16_t CompiledDFA::get_inner_state(int idx) const
+{
+    return this->inner_states[idx];
+}
+
+const ScanRule &CompiledDFA::get_scan_rule(uint16_t state) const
+{
+    return this->accel[state];
+}
+
+/**
+ * @brief Returns the class of a byte, or of multibyte characters for MULTIBYTE.
+ */
+int CompiledDFA::get_class(int byte) const
+{
+    return this->byte_class[byte];
+}
+
+/**
+ * @brief Returns the table entry of a state for a class, flags included.
+ */
+uint16_t CompiledDFA::get_entry(uint16_t state, int cls) const
+{
+    return this->table[state * num_classes + cls];
+}
+
+/**
+ * @brief Hashes the byte classes (the MULTIBYTE slot included), the transition table
+ *        and the attributes (FNV-1a), so generated code can tell whether it was built
+ *        from the same tables.
+ */
+uint32_t CompiledDFA::get_fingerprint() const
+{
+    uint32_t hash = 2166136261u;
+    auto mix = [&](uint32_t value){
+        for(int k = 0; k < 4; k ++){
+            hash = (hash ^ ((value >> (8 * k)) & 0xff)) * 16777619u;
+        }
+    };
+    for(int b = 0; b <= MULTIBYTE; b ++){
+        mix(byte_class[b]);
+    }
+    for(int k = 0; k < num_states * num_classes; k ++){
+        mix(table[k]);
+    }
+    for(int i = 0; i < num_states; i ++){
+        mix(attrs[i]);
+    }
+    return hash;
 }
 
-State DFA::get_current_state()
+/**
+ * @brief Makes `scan` run the generated code of `scanner` instead of the table loop.
+ *
+ * @throws std::invalid_argument If the scanner was generated from different tables.
+ */
+int CompiledDFA::set_direct_scanner(const DirectScanner &scanner)
 {
-    return this->current_state;
+    if(scanner.num_states != num_states || scanner.num_classes != num_classes || scanner.fingerprint != get_fingerprint()){
+        throw std::invalid_argument("DirectScanner was generated from a different DFA");
+    }
+    this->direct_scan = scanner.scan;
+    return 0;
 }
   
+// Class InternTable
+InternTable::InternTable(const InternTable &other)
+{
+    *this = other;
+}
+
+InternTable &InternTable::operator=(const InternTable &other)
+{
+    if(this != &other){
+        clear();
+        for(auto &name : other.names){
+            intern(name);
+        }
+    }
+    return *this;
+}
+
+/**
+ * @brief Returns the id of `name`, assigning the next free id if it is new.
+ */
+uint32_t InternTable::intern(std::string_view name)
+{
+    auto it = ids.find(name);
+    if(it != ids.end()){
+        return it->second;
+    }
+    uint32_t id = names.size();
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+std::string_view InternTable::get_name(uint32_t id) const
+{
+    return names[id];
+}
+
+size_t InternTable::size() const
+{
+    return names.size();
+}
+
+int InternTable::clear()
+{
+    ids.clear();
+    names.clear();
+    return 0;
+}
+
 // Class LexicalAnalyzer  
-LexicalAnalyzer::LexicalAnalyzer(DFA dfa) : dfa(dfa) {}
+LexicalAnalyzer::LexicalAnalyzer(DFA dfa) : LexicalAnalyzer(dfa.compile()) {}
+
+LexicalAnalyzer::LexicalAnalyzer(CompiledDFA table)
+    : table(table), error_code(0), consumed(0), base(0), num_threads(1), recovery(false), resyncing(false), sync_bytes{},
+      identifier_kind(-1), pull_source(nullptr), pull_status(END_OF_INPUT) {}
+
+int LexicalAnalyzer::set_dfa(DFA dfa)
+{
+    return set_dfa(dfa.compile());
+}
+
+int LexicalAnalyzer::set_dfa(CompiledDFA table)
+{
+    this->table = table;
+    return OK;
+}
+
+/**
+ * @brief Sets how many threads `analyze` may use on large inputs; 0 means one per
+ *        hardware thread. The result does not depend on this setting.
+ */
+int LexicalAnalyzer::set_threads(unsigned threads)
+{
+    this->num_threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    return OK;
+}
+
+/**
+ * @brief Turns on error recovery: `analyze` reports each lexical error as a Diagnostic
+ *        and goes on at the next byte in `sync`, instead of stopping at the first error.
+ *        An empty `sync` turns recovery off again.
+ *
+ * @param sync The bytes a token can safely start at, typically whitespace and the
+ *             first characters of operators.
+ */
+int LexicalAnalyzer::set_recovery(std::string_view sync)
+{
+    this->recovery = !sync.empty();
+    this->sync_bytes.fill(false);
+    for(unsigned char ch : sync){
+        this->sync_bytes[ch] = true;
+    }
+    return OK;
+}
 
-int LexicalAnalyzer::set_dfa(DFA)
+/**
+ * @brief Makes tokens of kind `identifier_kind` whose lexeme is in `keywords` take the
+ *        kind of that keyword instead.
+ *
+ * @details This is for a DFA without keyword states, which lexes every word as an
+ *          identifier: one perfect-hash lookup per identifier then gives the same
+ *          tokens as a DFA with a state per keyword prefix. A negative
+ *          `identifier_kind` turns the lookup off.
+ */
+int LexicalAnalyzer::set_keywords(KeywordSet keywords, int identifier_kind)
 {
-    this->dfa = dfa;
+    this->keyword_set = keywords;
+    this->identifier_kind = identifier_kind;
     return OK;
 }
 
+/**
+ * @brief Returns the first position at or after `pos` holding a sync byte, or the end
+ *        of `input`.
+ */
+size_t LexicalAnalyzer::skip_to_sync(std::string_view input, size_t pos)
+{
+    while(pos < input.size() && !sync_bytes[(unsigned char)input[pos]]){
+        pos ++;
+    }
+    return pos;
+}
+
+/**
+ * @brief Records the error `cursor` stopped on as a Diagnostic and skips the bad token
+ *        and the bytes after it up to the next sync byte.
+ *
+ * @param more Whether more input follows `input`; if the skip reaches its end, it is
+ *             then continued there (`resyncing`).
+ * @return The position to restart the scan from.
+ */
+size_t LexicalAnalyzer::record_error(std::string_view input, const ScanCursor &cursor, bool more)
+{
+    Diagnostic diagnostic;
+    diagnostic.offset = base + cursor.token_start;
+    diagnostic.status = cursor.status == ScanCursor::FAILED ? UNKNOWN_ERROR : UNRECOGNIZED_SYMBOL;
+    diagnostic.error = cursor.status == ScanCursor::FAILED ? cursor.error : 0;
+    size_t next = skip_to_sync(input, std::max(cursor.pos, cursor.token_start + 1));
+    diagnostic.length = next - cursor.token_start;
+    diagnostics.push_back(diagnostic);
+    resyncing = next == input.size() && more;
+    return next;
+}
+
 /**
  * @brief Analyzes the given input string using a Deterministic Finite Automaton (DFA)
  *        to tokenize and categorize the input symbols.
  *
- * @param input The string to be analyzed by the lexical analyzer.
+ * @param input The bytes to be analyzed by the lexical analyzer.
+ * @param eof   Whether `input` reaches the end of the source. If false, running out of
+ *              input in the middle of a token is not an error: the analysis stops, and
+ *              `get_consumed()` tells where that token starts so the caller can
+ *              call `analyze` again from there once more input is available.
+ *              Token offsets count from the start of the source, i.e. they include
+ *              everything consumed by earlier calls with `eof` false.
  * @return An integer indicating the result of the analysis:
  *         - OK: The input was successfully analyzed.
  *         - UNRECOGNIZED_SYMBOL: An unrecognized symbol was encountered in the input.
  *         - UNKNOWN_ERROR: An unknown error occurred during the analysis.
  *         - UNRECOGNIZED_IDENTIFIER: An unrecognized identifier was found in the input.
  *
- * @details The function iterates through the input string using two pointers,
- *          `pcur` (current position) and `pstart` (start position of the current token).
- *          It resets the DFA to its initial state and then processes each character
- *          in the input string.
+ * @details The input is scanned with CompiledDFA::scan, one table lookup per
+ *          character; no memory is allocated until a token is stored. When a
+ *          transition enters a state flagged ACCEL, the rest of the run that state
+ *          loops on is skipped with ByteScanner before stepping again.
  *          
- *          For each character, it checks if the DFA can transition to the next state
- *          using the current character as a symbol. If the DFA cannot transition,
- *          it returns UNRECOGNIZED_SYMBOL.
+ *          If a character has no transition, it returns UNRECOGNIZED_SYMBOL. So does
+ *          a malformed UTF-8 sequence, or one that the end of the source cuts off;
+ *          well-formed multibyte characters are single symbols (see CompiledDFA).
  *          
  *          If the DFA reaches a FAIL state, it records the error code and returns UNKNOWN_ERROR.
  *          
- *          If the DFA reaches an OK state, it checks if the attribute of the state is not IGNORE.
- *          If not, it adds the current token (from `pstart` to `pcur-1`) and its attribute
- *          to the result list. The `pcur` is decremented to re-process the last character
- *          of the token in the next iteration (to ensure no character is skipped).
+ *          Every token that reaches an OK state whose attribute is not IGNORE is added
+ *          to the result list. The lexeme is interned into the spelling table of its
+ *          kind, which copies it only the first time that spelling is seen.
+ *          
+ *          If the input ends in the middle of a token, it returns UNRECOGNIZED_IDENTIFIER
+ *          (or OK if `eof` is false). Tokens found before the error are kept.
  *          
- *          If the DFA does not reach an OK state after processing all characters,
- *          it returns UNRECOGNIZED_IDENTIFIER.
- */
-int LexicalAnalyzer::analyze(std::string input)
-{
-    int pcur = 0;
-    while(pcur < input.size()){
-        std::string scur;
-        dfa.reset();
-        State state = dfa.get_current_state();
-        while(state.get_type() != State::OK && pcur < input.size()){
-            if(dfa.go_next_state(Symbol(input[pcur]))){
-                return UNRECOGNIZED_SYMBOL;
+ *          With more than one thread (see `set_threads`), inputs of at least two
+ *          PARALLEL_CHUNKs are scanned by `scan_parallel` instead, with the same result.
+ *
+ *          In recovery mode (see `set_recovery`) UNRECOGNIZED_SYMBOL and UNKNOWN_ERROR
+ *          are recorded in `get_diagnostics()` instead of being returned, and the scan
+ *          restarts at the next sync byte. A skip that reaches the end of a non-final
+ *          input continues at the start of the next call. The rest of the input after
+ *          an error is scanned sequentially: `scan_parallel` simulates every chunk up
+ *          to the end, so restarting it after each error would cost the whole input
+ *          per error.
+ */
+int LexicalAnalyzer::analyze(std::string_view input, bool eof)
+{
+    consumed = 0;
+    ScanCursor cursor;
+    bool parallel = num_threads > 1;
+    if(resyncing){
+        // still skipping an error that ran past the end of the previous input
+        cursor.pos = cursor.token_start = skip_to_sync(input, 0);
+        diagnostics.back().length += cursor.pos;
+        resyncing = cursor.pos == input.size() && !eof;
+    }
+    while(true){
+        if(parallel && input.size() - cursor.pos >= 2 * PARALLEL_CHUNK){
+            cursor = scan_parallel(input, cursor.pos);
+        }else{
+            cursor = table.scan((const unsigned char *)input.data(), input.size(), cursor, [&](size_t first, size_t last, int attr){
+                if(attr != IGNORE){
+                    push_token(input, first, last, attr);
+                }
+                return true;
+            });
+        }
+        if(eof && cursor.status == ScanCursor::RUNNING && cursor.pos < input.size()){
+            // a UTF-8 character cut off by the end of the source
+            cursor.status = ScanCursor::UNRECOGNIZED_SYMBOL;
+        }
+        if(cursor.status == ScanCursor::RUNNING || !recovery){
+            break;
+        }
+        size_t next = record_error(input, cursor, !eof);
+        parallel = false;
+        cursor = ScanCursor();
+        cursor.pos = cursor.token_start = next;
+    }
+    if(cursor.status == ScanCursor::UNRECOGNIZED_SYMBOL){
+        return UNRECOGNIZED_SYMBOL;
+    }
+    if(cursor.status == ScanCursor::FAILED){
+        error_code = cursor.error;
+        return UNKNOWN_ERROR;
+    }
+    if(eof){
+        return cursor.token_start == cursor.pos ? OK : UNRECOGNIZED_IDENTIFIER;
+    }
+    consumed = cursor.token_start;
+    base += consumed;
+    return OK;
+}
+
+/**
+ * @brief Interns the lexeme input[first, last) and returns its Token, with the offset
+ *        counted from the start of the source. Identifiers found in the keyword set
+ *        (see `set_keywords`) get the keyword's kind.
+ *
+ * @throws std::out_of_range If the kind, length or offset does not fit in a Token.
+ */
+Token LexicalAnalyzer::make_token(std::string_view input, size_t first, size_t last, int kind)
+{
+    std::string_view lexeme = input.substr(first, last - first);
+    if(kind == identifier_kind){
+        int keyword = keyword_set.find(lexeme);
+        kind = keyword >= 0 ? keyword : kind;
+    }
+    if(kind < 0 || kind > Token::MAX_KIND || last - first > Token::MAX_LENGTH){
+        throw std::out_of_range("Token kind or length out of range");
+    }
+    if(base + first > UINT32_MAX){
+        throw std::out_of_range("Token offset does not fit in 32 bits");
+    }
+    if(kind >= spellings.size()){
+        spellings.resize(kind + 1);
+    }
+    Token token;
+    token.offset = base + first;
+    token.length = last - first;
+    token.kind = kind;
+    token.id = spellings[kind].intern(lexeme);
+    return token;
+}
+
+void LexicalAnalyzer::push_token(std::string_view input, size_t first, size_t last, int kind)
+{
+    result.push_back(make_token(input, first, last, kind));
+}
+
+/**
+ * @brief Analyzes everything readable from `source`, window by window.
+ *
+ * @param source The byte source. Its windows are consumed as tokens are completed.
+ * @return The result of the last `analyze` call, as for `analyze(std::string_view, bool)`.
+ *
+ * @details A token that is cut off by the end of a window is not consumed, so it is
+ *          scanned again from its first byte once `refill` has appended the rest.
+ *          Like the line-based drivers this replaces, input that does not end with a
+ *          newline is treated as if it did; only the unfinished last token is copied
+ *          to add it.
+ */
+int LexicalAnalyzer::analyze(SourceBuffer &source)
+{
+    while(true){
+        std::string_view window = source.window();
+        bool eof = source.at_eof();
+        if(eof && (window.empty() || window.back() == '\n')){
+            return analyze(window, true);
+        }
+        int ret = analyze(window, false);
+        if(ret != OK){
+            return ret;
+        }
+        if(eof){
+            std::string tail(window.substr(consumed));
+            tail += '\n';
+            return analyze(tail, true);
+        }
+        source.consume(consumed);
+        source.refill();
+    }
+}
+
+/**
+ * @brief Starts a pull analysis of `input`: `next_token` then returns its tokens one
+ *        at a time, instead of `analyze` collecting all of them in `get_result()`.
+ *
+ * @details The analyzer only keeps a view of `input`, which must stay valid until the
+ *          last call to `next_token`. Spellings and diagnostics accumulate as with
+ *          `analyze`; `reset` clears them.
+ */
+int LexicalAnalyzer::start(std::string_view input)
+{
+    this->pull_window = input;
+    this->pull_source = nullptr;
+    this->pull_cursor = ScanCursor();
+    this->pull_status = OK;
+    this->resyncing = false;
+    this->base = 0;
+    return OK;
+}
+
+/**
+ * @brief Starts a pull analysis of everything readable from `source`, refilling its
+ *        window as `next_token` reaches the end of it, so memory stays bounded by the
+ *        window size however long the input is.
+ */
+int LexicalAnalyzer::start(SourceBuffer &source)
+{
+    start(source.window());
+    this->pull_source = &source;
+    return OK;
+}
+
+/**
+ * @brief Lexes the next token of the input given to `start`.
+ *
+ * @param token Set to the next token that is not IGNORE, with the same offset, kind
+ *              and id `analyze` would have given it.
+ * @return OK if `token` was set, END_OF_INPUT once the input is exhausted, or the
+ *         error `analyze` would have returned at that point (UNRECOGNIZED_SYMBOL,
+ *         UNKNOWN_ERROR with `get_error()` set, or UNRECOGNIZED_IDENTIFIER). After
+ *         that every call returns the same code.
+ *
+ * @details The DFA runs only until the next token is complete, and the token is not
+ *          stored, so the state kept between calls is a cursor into the window. In
+ *          recovery mode errors are recorded in `get_diagnostics()` and lexing goes
+ *          on, as in `analyze`. Tokens are always scanned on the calling thread.
+ */
+int LexicalAnalyzer::next_token(Token &token)
+{
+    while(pull_status == OK){
+        if(resyncing){
+            // still skipping an error that ran past the end of the previous window
+            size_t next = skip_to_sync(pull_window, pull_cursor.pos);
+            diagnostics.back().length += next - pull_cursor.pos;
+            pull_cursor.pos = pull_cursor.token_start = next;
+            resyncing = next == pull_window.size() && pull_source != nullptr;
+        }
+        bool found = false;
+        pull_cursor = table.scan((const unsigned char *)pull_window.data(), pull_window.size(), pull_cursor, [&](size_t first, size_t last, int attr){
+            if(attr == IGNORE){
+                return true;
             }
-            if(dfa.get_current_state().get_type() != State::START){
-                scur += input[pcur];
+            token = make_token(pull_window, first, last, attr);
+            found = true;
+            return false;
+        });
+        if(found){
+            return OK;
+        }
+        if(pull_source == nullptr && pull_cursor.status == ScanCursor::RUNNING && pull_cursor.pos < pull_window.size()){
+            // a UTF-8 character cut off by the end of the input
+            pull_cursor.status = ScanCursor::UNRECOGNIZED_SYMBOL;
+        }
+        if(pull_cursor.status != ScanCursor::RUNNING){
+            if(recovery){
+                size_t next = record_error(pull_window, pull_cursor, pull_source != nullptr);
+                pull_cursor = ScanCursor();
+                pull_cursor.pos = pull_cursor.token_start = next;
+                continue;
             }
-            pcur ++;
-            state = dfa.get_current_state();
-            if(state.get_type() == State::FAIL){
-                // std::cout << "ERROR: " << state.get_id() << " " << scur.substr(0, scur.size() - 1) << std::endl;
-                error_code = state.get_attr();
-                return UNKNOWN_ERROR;
+            if(pull_cursor.status == ScanCursor::FAILED){
+                error_code = pull_cursor.error;
+                pull_status = UNKNOWN_ERROR;
+            }else{
+                pull_status = UNRECOGNIZED_SYMBOL;
             }
+            break;
         }
-        // std::cout << "id:" << state.get_id() << " str:" << scur.substr(0, scur.size() - 1) << " attr:" << state.get_attr() << std::endl;
-        if(state.get_type() == State::OK){
-            if(state.get_attr() != IGNORE){
-                result.push_back({scur.substr(0, scur.size() - 1), state.get_attr()});
-            }
-            pcur --;
+
+        // the window is exhausted: slide the source, then finish the last token
+        // against a '\n' as analyze(SourceBuffer &) does
+        size_t keep = pull_cursor.token_start;
+        if(pull_source != nullptr && !pull_source->at_eof()){
+            pull_source->consume(keep);
+            pull_source->refill();
+            pull_window = pull_source->window();
+        }else if(pull_source != nullptr && !pull_window.empty() && pull_window.back() != '\n'){
+            pull_tail.assign(pull_window.substr(keep));
+            pull_tail += '\n';
+            pull_window = pull_tail;
+            pull_source = nullptr;
         }else{
-            return UNRECOGNIZED_IDENTIFIER;
+            pull_status = pull_cursor.token_start == pull_cursor.pos ? END_OF_INPUT : UNRECOGNIZED_IDENTIFIER;
+            break;
         }
+        base += keep;
+        pull_cursor.pos -= keep;
+        pull_cursor.token_start = 0;
     }
-    return OK;
+    return pull_status;
 }
 
-std::vector<std::pair<std::string, int>> LexicalAnalyzer::get_result()
+const CompiledDFA &LexicalAnalyzer::get_dfa() const
+{
+    return this->table;
+}
+
+/**
+ * @brief Returns the tokens found so far, without copying them.
+ *
+ * The reference stays valid until the next call to `analyze` or `reset`.
+ */
+const std::vector<Token> &LexicalAnalyzer::get_result() const
 {
     return this->result;
 }
 
+/**
+ * @brief Returns the text of a token produced by this analyzer.
+ *
+ * The view points into the spelling table, so it outlives the analyzed input.
+ */
+std::string_view LexicalAnalyzer::lexeme(const Token &token) const
+{
+    return spellings[token.kind].get_name(token.id);
+}
+
+/**
+ * @brief Returns the distinct spellings seen for a kind, indexed by Token::id.
+ */
+const InternTable &LexicalAnalyzer::get_spellings(int kind) const
+{
+    static const InternTable empty;
+    return kind >= 0 && kind < spellings.size() ? spellings[kind] : empty;
+}
+
+/**
+ * @brief Returns the errors found in recovery mode, in input order.
+ */
+const std::vector<Diagnostic> &LexicalAnalyzer::get_diagnostics() const
+{
+    return this->diagnostics;
+}
+
 int LexicalAnalyzer::reset()
 {
-    this->dfa.reset();
     this->result.clear();
+    this->spellings.clear();
+    this->diagnostics.clear();
+    this->resyncing = false;
+    this->consumed = 0;
+    this->base = 0;
     return OK;
 }
 
@@ -226,3 +1080,8 @@ int LexicalAnalyzer::get_error()
 {
     return this->error_code;
 }
+
+size_t LexicalAnalyzer::get_consumed()
+{
+    return this->consumed;
+}
@@ -0,0 +1,65 @@
+#include "line_index.h"
+#include "simd_scan.h"
+
+#include <algorithm>
+
+LineIndex::LineIndex() : size(0), streamed(true), line_starts{0} {}
+
+LineIndex::LineIndex(std::string_view text) : text(text), size(text.size()), streamed(false) {}
+
+void LineIndex::build() const
+{
+    if(streamed){
+        return;
+    }
+    auto p = (const unsigned char *)text.data(), end = p + text.size();
+    line_starts.resize(ByteScanner::count('\n', p, end) + 1);
+    line_starts[0] = 0;
+    ByteScanner::find_all('\n', p, end, line_starts.data() + 1);
+    for(size_t k = 1; k < line_starts.size(); k ++){
+        line_starts[k] ++;
+    }
+}
+
+/**
+ * @brief Adds the next `chunk` of a streamed input to an index made without a text.
+ *        Not to be called while other threads locate offsets.
+ */
+int LineIndex::append(std::string_view chunk)
+{
+    auto p = (const unsigned char *)chunk.data(), end = p + chunk.size();
+    size_t first = line_starts.size();
+    line_starts.resize(first + ByteScanner::count('\n', p, end));
+    ByteScanner::find_all('\n', p, end, line_starts.data() + first);
+    for(size_t k = first; k < line_starts.size(); k ++){
+        line_starts[k] += size + 1;
+    }
+    size += chunk.size();
+    return 0;
+}
+
+/**
+ * @brief Returns the line and column of the byte at `offset`. An offset at or past
+ *        the end of the text is placed after its last byte.
+ */
+SourcePosition LineIndex::locate(size_t offset) const
+{
+    std::call_once(built, [this]{
+        build();
+    });
+    offset = std::min(offset, size);
+    size_t line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin();
+    return {line, offset - line_starts[line - 1] + 1};
+}
+
+/**
+ * @brief Returns the number of lines, counting the text after the last newline as a
+ *        line even when it is empty.
+ */
+size_t LineIndex::get_num_lines() const
+{
+    std::call_once(built, [this]{
+        build();
+    });
+    return line_starts.size();
+}
@@ -0,0 +1,160 @@
+#include "lexical_analysis.h"
+#include <algorithm>
+#include <thread>
+
+// A token found by a speculative run, before it is interned
+struct RawToken
+{
+    size_t first, last;
+    int attr;
+};
+
+// One simulation of a chunk from a guessed entry state
+struct ChunkRun
+{
+    std::vector<RawToken> tokens;
+    ScanCursor end;
+    size_t sync = ScanCursor::UNKNOWN;      // where it joined the run from the start state
+};
+
+struct Chunk
+{
+    size_t begin, end;
+    ChunkRun main;                                  // entered in the start state
+    std::vector<std::pair<size_t, size_t>> idle;    // [from, to]: main is in the start state before byte from..to
+    std::vector<ChunkRun> entered;                  // indexed by state, entered in the middle of a token
+
+    bool is_idle(size_t pos) const
+    {
+        auto it = std::upper_bound(idle.begin(), idle.end(), std::make_pair(pos, SIZE_MAX));
+        return it != idle.begin() && pos <= std::prev(it)->second;
+    }
+};
+
+/**
+ * @brief Simulates one chunk from the start state and from every inner state.
+ *
+ * @details The run from the start state is done first, recording the ranges where
+ *          it sits in the start state between tokens. Each run from an inner state
+ *          stops as soon as it finishes a token at a position where the main run is
+ *          in the start state too, because from there on both produce the same
+ *          tokens. Most runs therefore end within a token or two; only a run from
+ *          inside a comment may have to go to the end of the chunk.
+ */
+static void simulate_chunk(const CompiledDFA &table, const unsigned char *data, Chunk &chunk)
+{
+    size_t idle_from = chunk.begin;
+    ScanCursor cursor;
+    cursor.pos = cursor.token_start = chunk.begin;
+    chunk.main.end = table.scan(data, chunk.end, cursor, [&](size_t first, size_t last, int attr){
+        chunk.idle.push_back({idle_from, first});
+        chunk.main.tokens.push_back({first, last, attr});
+        idle_from = last;
+        return true;
+    });
+    chunk.idle.push_back({idle_from, chunk.main.end.token_start});
+
+    chunk.entered.resize(table.get_num_states());
+    for(int k = 0; k < table.get_num_inner_states(); k ++){
+        uint16_t state = table.get_inner_state(k);
+        ChunkRun &run = chunk.entered[state];
+        cursor.state = state;
+        cursor.pos = chunk.begin;
+        cursor.token_start = ScanCursor::UNKNOWN;
+        run.end = table.scan(data, chunk.end, cursor, [&](size_t first, size_t last, int attr){
+            run.tokens.push_back({first, last, attr});
+            if(chunk.is_idle(last)){
+                run.sync = last;
+                return false;
+            }
+            return true;
+        });
+    }
+}
+
+/**
+ * @brief Scans the input from `from` on several threads and appends its tokens to the
+ *        result.
+ *
+ * @param input The complete input.
+ * @param from  Where to start, in the start state.
+ * @return The cursor where a sequential scan of `input` from `from` would have stopped.
+ *
+ * @details The input is cut into one chunk per thread. A chunk boundary can fall
+ *          between tokens or inside one, so each thread simulates its chunk from
+ *          every state the scan could be in at that point (see `simulate_chunk`).
+ *          A sequential pass then walks the chunks in order: the end state of one
+ *          chunk selects which simulation of the next chunk is the real one, and a
+ *          simulation that joined the main run continues with the main run's tokens.
+ *          Tokens are interned in that pass, so spelling ids are the same as for a
+ *          sequential scan. A boundary is moved back to the start of a UTF-8
+ *          character it would split, so a chunk that still stops on a cut-off
+ *          character before its end has a malformed one there.
+ */
+ScanCursor LexicalAnalyzer::scan_parallel(std::string_view input, size_t from)
+{
+    const unsigned char *data = (const unsigned char *)input.data();
+    size_t size = input.size() - from;
+    size_t num_chunks = std::min<size_t>(num_threads, size / PARALLEL_CHUNK);
+    std::vector<Chunk> chunks(num_chunks);
+    std::vector<size_t> bounds(num_chunks + 1);
+    for(size_t i = 0; i <= num_chunks; i ++){
+        bounds[i] = from + size * i / num_chunks;
+        if(i == 0 || i == num_chunks){
+            continue;
+        }
+        // back to the first byte of a UTF-8 character that the boundary would split
+        size_t lead = bounds[i];
+        while(lead > bounds[i] - 3 && (data[lead] & 0xc0) == 0x80){
+            lead --;
+        }
+        if((data[lead] & 0xc0) != 0x80){
+            bounds[i] = lead;
+        }
+    }
+    for(size_t i = 0; i < num_chunks; i ++){
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+    }
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < num_chunks; i ++){
+        workers.emplace_back(simulate_chunk, std::cref(table), data, std::ref(chunks[i]));
+    }
+    simulate_chunk(table, data, chunks[0]);
+    for(auto &worker : workers){
+        worker.join();
+    }
+
+    ScanCursor cursor;
+    for(auto &chunk : chunks){
+        size_t carried = cursor.token_start;
+        const ChunkRun *run = cursor.state == 0 ? &chunk.main : &chunk.entered[cursor.state];
+        for(auto &token : run->tokens){
+            if(token.attr != IGNORE){
+                push_token(input, token.first == ScanCursor::UNKNOWN ? carried : token.first, token.last, token.attr);
+            }
+        }
+        if(run->sync != ScanCursor::UNKNOWN){
+            auto it = std::lower_bound(chunk.main.tokens.begin(), chunk.main.tokens.end(), run->sync, [](const RawToken &token, size_t pos){
+                return token.first < pos;
+            });
+            for(; it != chunk.main.tokens.end(); it ++){
+                if(it->attr != IGNORE){
+                    push_token(input, it->first, it->last, it->attr);
+                }
+            }
+            run = &chunk.main;
+        }
+        cursor = run->end;
+        if(cursor.token_start == ScanCursor::UNKNOWN){
+            cursor.token_start = carried;
+        }
+        if(cursor.status == ScanCursor::RUNNING && cursor.pos < chunk.end && &chunk != &chunks.back()){
+            cursor.status = ScanCursor::UNRECOGNIZED_SYMBOL;
+        }
+        if(cursor.status != ScanCursor::RUNNING){
+            break;
+        }
+    }
+    return cursor;
+}
@@ -0,0 +1,259 @@
+#include "simd_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SCANNER_X86 1
+#endif
+
+static const unsigned char *skip_scalar(const ScanRule &rule, const unsigned char *p, const unsigned char *end)
+{
+    while(p < end && rule.contains(*p)){
+        p ++;
+    }
+    return p;
+}
+
+static size_t count_scalar(unsigned char ch, const unsigned char *p, const unsigned char *end)
+{
+    size_t n = 0;
+    for(; p < end; p ++){
+        n += *p == ch;
+    }
+    return n;
+}
+
+static size_t find_all_scalar(unsigned char ch, const unsigned char *p, const unsigned char *end, size_t *positions)
+{
+    size_t n = 0;
+    for(const unsigned char *q = p; q < end; q ++){
+        if(*q == ch){
+            positions[n ++] = q - p;
+        }
+    }
+    return n;
+}
+
+#ifdef BYTE_SCANNER_X86
+
+// The vector kernels compute, for every byte of a block, whether it belongs to the
+// run; the first byte that does not ends the run. The last partial block is left to
+// the scalar loop.
+
+static inline __m128i in_range_sse2(__m128i v, char lo, char hi)
+{
+    __m128i u = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(u, _mm_set1_epi8(hi - lo)), u);
+}
+
+static inline __m128i match_sse2(const ScanRule &rule, __m128i v)
+{
+    switch(rule.kind){
+        case ScanRule::SPACE:
+            return _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        case ScanRule::ALNUM:
+            return _mm_or_si128(in_range_sse2(v, '0', '9'),
+                in_range_sse2(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'));
+        case ScanRule::DIGIT:
+            return in_range_sse2(v, '0', '9');
+        default: {
+            // signed compare: bytes < 0x20 and bytes >= 0x80 are both "less than" 0x20
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+            __m128i stop = _mm_andnot_si128(space, _mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+            stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+            stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, _mm_set1_epi8(rule.c1)));
+            stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, _mm_set1_epi8(rule.c2)));
+            return _mm_xor_si128(stop, _mm_set1_epi8(-1));
+        }
+    }
+}
+
+static const unsigned char *skip_sse2(const ScanRule &rule, const unsigned char *p, const unsigned char *end)
+{
+    while(end - p >= 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned mask = ~_mm_movemask_epi8(match_sse2(rule, v)) & 0xffff;
+        if(mask){
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    return skip_scalar(rule, p, end);
+}
+
+static size_t count_sse2(unsigned char ch, const unsigned char *p, const unsigned char *end)
+{
+    __m128i c = _mm_set1_epi8(ch);
+    size_t n = 0;
+    for(; end - p >= 16; p += 16){
+        n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), c)));
+    }
+    return n + count_scalar(ch, p, end);
+}
+
+static size_t find_all_sse2(unsigned char ch, const unsigned char *p, const unsigned char *end, size_t *positions)
+{
+    __m128i c = _mm_set1_epi8(ch);
+    const unsigned char *begin = p;
+    size_t n = 0;
+    for(; end - p >= 16; p += 16){
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), c));
+        for(; mask; mask &= mask - 1){
+            positions[n ++] = p - begin + __builtin_ctz(mask);
+        }
+    }
+    size_t tail = find_all_scalar(ch, p, end, positions + n);
+    for(size_t k = n; k < n + tail; k ++){
+        positions[k] += p - begin;
+    }
+    return n + tail;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i in_range_avx2(__m256i v, char lo, char hi)
+{
+    __m256i u = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(u, _mm256_set1_epi8(hi - lo)), u);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i match_avx2(const ScanRule &rule, __m256i v)
+{
+    switch(rule.kind){
+        case ScanRule::SPACE:
+            return _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        case ScanRule::ALNUM:
+            return _mm256_or_si256(in_range_avx2(v, '0', '9'),
+                in_range_avx2(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'));
+        case ScanRule::DIGIT:
+            return in_range_avx2(v, '0', '9');
+        default: {
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+            __m256i stop = _mm256_andnot_si256(space, _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(rule.c1)));
+            stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(rule.c2)));
+            return _mm256_xor_si256(stop, _mm256_set1_epi8(-1));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static const unsigned char *skip_avx2(const ScanRule &rule, const unsigned char *p, const unsigned char *end)
+{
+    while(end - p >= 32){
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(match_avx2(rule, v));
+        if(mask){
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return skip_sse2(rule, p, end);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t count_avx2(unsigned char ch, const unsigned char *p, const unsigned char *end)
+{
+    __m256i c = _mm256_set1_epi8(ch);
+    size_t n = 0;
+    for(; end - p >= 32; p += 32){
+        n += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), c)));
+    }
+    return n + count_sse2(ch, p, end);
+}
+
+__attribute__((target("avx2")))
+static size_t find_all_avx2(unsigned char ch, const unsigned char *p, const unsigned char *end, size_t *positions)
+{
+    __m256i c = _mm256_set1_epi8(ch);
+    const unsigned char *begin = p;
+    size_t n = 0;
+    for(; end - p >= 32; p += 32){
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), c));
+        for(; mask; mask &= mask - 1){
+            positions[n ++] = p - begin + __builtin_ctz(mask);
+        }
+    }
+    size_t tail = find_all_sse2(ch, p, end, positions + n);
+    for(size_t k = n; k < n + tail; k ++){
+        positions[k] += p - begin;
+    }
+    return n + tail;
+}
+
+#endif
+
+typedef const unsigned char *(*SkipFunction)(const ScanRule &, const unsigned char *, const unsigned char *);
+typedef size_t (*CountFunction)(unsigned char, const unsigned char *, const unsigned char *);
+typedef size_t (*FindAllFunction)(unsigned char, const unsigned char *, const unsigned char *, size_t *);
+
+struct ScannerImplementation
+{
+    SkipFunction skip;
+    CountFunction count;
+    FindAllFunction find_all;
+    const char *name;
+};
+
+static ScannerImplementation select_implementation()
+{
+#ifdef BYTE_SCANNER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return {skip_avx2, count_avx2, find_all_avx2, "avx2"};
+    }
+    return {skip_sse2, count_sse2, find_all_sse2, "sse2"};
+#else
+    return {skip_scalar, count_scalar, find_all_scalar, "scalar"};
+#endif
+}
+
+static const ScannerImplementation &get_scanner()
+{
+    static const ScannerImplementation implementation = select_implementation();
+    return implementation;
+}
+
+/**
+ * @brief Returns the first byte in [p, end) that is not part of the run described by `rule`,
+ *        or `end` if the run reaches the end of the input.
+ */
+const unsigned char *ByteScanner::skip(const ScanRule &rule, const unsigned char *p, const unsigned char *end)
+{
+    if(rule.kind == ScanRule::NONE){
+        return p;
+    }
+    return get_scanner().skip(rule, p, end);
+}
+
+/**
+ * @brief Returns how many bytes in [p, end) are equal to `ch`.
+ */
+size_t ByteScanner::count(unsigned char ch, const unsigned char *p, const unsigned char *end)
+{
+    return get_scanner().count(ch, p, end);
+}
+
+/**
+ * @brief Stores the offset from `p` of every byte in [p, end) equal to `ch` into
+ *        `positions`, in increasing order, and returns how many there are.
+ *        `positions` must have room for `count(ch, p, end)` entries.
+ */
+size_t ByteScanner::find_all(unsigned char ch, const unsigned char *p, const unsigned char *end, size_t *positions)
+{
+    return get_scanner().find_all(ch, p, end, positions);
+}
+
+/**
+ * @brief Returns the name of the kernel set chosen for this CPU: "avx2", "sse2" or "scalar".
+ */
+const char *ByteScanner::get_implementation()
+{
+    return get_scanner().name;
+}
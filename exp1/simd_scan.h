@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A run of bytes that a DFA state consumes without leaving itself.
+ *
+ * - SPACE: ' ', '\t', '\n' and '\r'
+ * - ALNUM: ASCII letters and digits
+ * - DIGIT: ASCII digits
+ * - UNTIL: every byte except `c1`, `c2` and the bytes that are not part of the
+ *          lexer alphabet (control characters other than whitespace, DEL and
+ *          bytes >= 0x80); this is the body of a comment.
+ */
+struct ScanRule
+{
+    enum Kind : uint8_t { NONE, SPACE, ALNUM, DIGIT, UNTIL } kind = NONE;
+    unsigned char c1 = 0, c2 = 0;
+
+    constexpr bool contains(unsigned char ch) const
+    {
+        switch(kind){
+            case SPACE:
+                return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+            case ALNUM:
+                return (ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z');
+            case DIGIT:
+                return ch >= '0' && ch <= '9';
+            case UNTIL:
+                if(ch == c1 || ch == c2 || ch >= 0x7f){
+                    return false;
+                }
+                return ch >= 0x20 || ch == '\t' || ch == '\n' || ch == '\r';
+            default:
+                return false;
+        }
+    }
+};
+
+/**
+ * @brief Finds the end of a run of bytes matching a ScanRule, and counts or locates
+ *        the occurrences of one byte, 16 or 32 bytes at a time.
+ *
+ * The implementation is picked once at runtime: AVX2 if the CPU supports it, SSE2 on
+ * other x86 machines, and a plain byte loop elsewhere. `utf8_length` is the one
+ * scalar helper, for the bytes the runs above stop at.
+ */
+class ByteScanner
+{
+    public:
+        static const unsigned char *skip(const ScanRule &, const unsigned char *, const unsigned char *);
+        static size_t count(unsigned char, const unsigned char *, const unsigned char *);
+        static size_t find_all(unsigned char, const unsigned char *, const unsigned char *, size_t *positions);
+        static const char *get_implementation();
+
+        /**
+         * @brief Returns the length of the UTF-8 character starting at `p`: 2 to 4 if
+         *        it is well-formed (no overlong forms, surrogates or code points above
+         *        U+10FFFF), 0 if it is not or `*p` is ASCII, and -1 if `end` cuts it off
+         *        before it could be told either way.
+         */
+        static int utf8_length(const unsigned char *p, const unsigned char *end)
+        {
+            unsigned char lead = *p, low = 0x80, high = 0xbf;     // range of the second byte
+            int length;
+            if(lead >= 0xc2 && lead <= 0xdf){
+                length = 2;
+            }else if(lead >= 0xe0 && lead <= 0xef){
+                length = 3;
+                low = lead == 0xe0 ? 0xa0 : 0x80;
+                high = lead == 0xed ? 0x9f : 0xbf;
+            }else if(lead >= 0xf0 && lead <= 0xf4){
+                length = 4;
+                low = lead == 0xf0 ? 0x90 : 0x80;
+                high = lead == 0xf4 ? 0x8f : 0xbf;
+            }else{
+                return 0;
+            }
+            for(int k = 1; k < length; k ++){
+                if(p + k == end){
+                    return -1;
+                }
+                if(p[k] < low || p[k] > high){
+                    return 0;
+                }
+                low = 0x80;
+                high = 0xbf;
+            }
+            return length;
+        }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "my_dfa.h"
+
+/**
+ * Build-time generation of the lexer tables.
+ *
+ * MakeDFA::make_dfa builds the lexer DFA from the rules of MakeDFA::get_rules, then
+ * DFA::compile turns it into a CompiledDFA. gen_scanner does this once at build time
+ * and writes the arrays of the result, together with a direct-coded scanner for
+ * them, to direct_scanner.cpp. The binaries wrap those arrays, which the compiler
+ * places in read-only data, so startup does no setup work, and since the tables and
+ * the scanners come from the same DFA, a change to the lexer rules reaches both.
+ */
+
+/**
+ * @brief Returns the lexer DFA generated at build time: the same tables as
+ *        `MakeDFA().make_dfa().compile()`, read straight from static storage.
+ */
+CompiledDFA get_static_dfa();
+
+/**
+ * @brief Returns the lexer DFA without keyword states, `MakeDFA().make_dfa(false).compile()`,
+ *        generated at build time. Keywords come out as identifiers; together with
+ *        get_static_keywords() in LexicalAnalyzer::set_keywords it lexes like get_static_dfa().
+ */
+CompiledDFA get_static_identifier_dfa();
+
+/**
+ * @brief Returns the perfect hash of `keywords`, built at compile time.
+ */
+KeywordSet get_static_keywords();
+
+/**
+ * @brief The direct-coded scanner for the tables of get_static_dfa(), written to
+ *        direct_scanner.cpp by gen_scanner at build time.
+ */
+extern const DirectScanner lexer_direct_scanner;
+
+/**
+ * @brief The direct-coded scanner for the tables of get_static_identifier_dfa().
+ */
+extern const DirectScanner identifier_direct_scanner;
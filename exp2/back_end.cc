@@ -0,0 +1,34 @@
+#include "back_end.h"
+#include "../exp3/quad_processor.h"
+
+// The symbol table for the back end, as exp3 reads it from the text of Output: the
+// variables without the temporaries, whose type is 0 for int and 1 for double
+static std::vector<SymbolTableEntry> MakeSymbolTable(const ICode &icode){
+    std::vector<SymbolTableEntry> symbol_table;
+    for(auto &entry : icode.symbol_table){
+        if(entry.type.substr(1) == "temp"){
+            continue;
+        }
+        symbol_table.push_back(SymbolTableEntry(entry.name));
+        symbol_table.back().type = entry.type == "int" ? 0 : 1;
+        symbol_table.back().value = "null";
+        symbol_table.back().offset = entry.offset;
+    }
+    return symbol_table;
+}
+
+static std::vector<Quadruple> MakeQuadruples(const ICode &icode){
+    std::vector<Quadruple> quadruples;
+    quadruples.reserve(icode.quad.size());
+    for(auto &quad : icode.quad){
+        quadruples.push_back(Quadruple(quad[0], quad[1], quad[2], quad[3]));
+    }
+    return quadruples;
+}
+
+std::string GenerateCode(const ICode &icode){
+    auto symbol_table = MakeSymbolTable(icode);
+    auto quadruples = MakeQuadruples(icode);
+    QuadProcessor processor(quadruples, symbol_table);
+    return processor.ProcessQuadruples();
+}
@@ -0,0 +1,15 @@
+// back_end.h
+#ifndef BACK_END_H_
+#define BACK_END_H_
+
+// The stage after parsing: target code generation by the QuadProcessor of exp3, on the
+// intermediate code in memory. Only back_end.cc includes exp3, whose classes
+// (SymbolTableEntry, ...) would clash with the parser's.
+
+#include <string>
+#include "syntax_parser.h"
+
+// the target code, as exp3 prints it for the text of Output(icode)
+std::string GenerateCode(const ICode &icode);
+
+#endif  // BACK_END_H_
@@ -0,0 +1,131 @@
+#include "batch_compiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include "back_end.h"
+#include "front_end.h"
+#include "source_buffer.h"
+
+BatchCompiler::BatchCompiler(std::vector<Unit> units, int jobs) : units_(std::move(units)) {
+    size_t workers = std::max<size_t>(1, std::min<size_t>(jobs > 0 ? jobs : 1, units_.size()));
+    for(size_t i = 0; i < workers; i ++){
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    // worker i starts with the i-th block of units
+    for(size_t unit = 0; unit < units_.size(); unit ++){
+        queues_[unit * workers / units_.size()]->units.push_back(unit);
+    }
+}
+
+std::vector<BatchCompiler::Unit> BatchCompiler::ReadManifest(std::istream &in){
+    std::vector<Unit> units;
+    std::string line;
+    while(std::getline(in, line)){
+        if(line.empty()){
+            continue;
+        }
+        Unit unit;
+        auto tab = line.find('\t');
+        unit.source = line.substr(0, tab);
+        unit.output = tab == std::string::npos ? unit.source + ".asm" : line.substr(tab + 1);
+        units.push_back(unit);
+    }
+    return units;
+}
+
+bool BatchCompiler::Next_(size_t worker, size_t &unit){
+    {
+        Queue &own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.units.empty()){
+            unit = own.units.front();
+            own.units.pop_front();
+            return true;
+        }
+    }
+    // no unit is ever added, so one pass over the others finds any that is left
+    for(size_t i = 1; i < queues_.size(); i ++){
+        Queue &victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.units.empty()){
+            unit = victim.units.back();
+            victim.units.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchCompiler::Compile_(Unit &unit, SyntaxParser &parser){
+    // a source that cannot be read leaves no output, not even one from an earlier run
+    std::string output;
+    int fd = open(unit.source.c_str(), O_RDONLY);
+    if(fd < 0){
+        unit.diagnostic = std::strerror(errno);
+        unlink(unit.output.c_str());
+        return;
+    }
+    std::unique_ptr<SourceBuffer> source;
+    std::string_view text;
+    try{
+        source = std::make_unique<SourceBuffer>(fd);
+        text = ReadProgram(*source);
+    }catch(const std::exception &error){
+        close(fd);
+        unit.diagnostic = error.what();
+        unlink(unit.output.c_str());
+        return;
+    }
+    try{
+        output = GenerateCode(ParseProgram(text, parser));
+    }catch(const SyntaxError &error){
+        output = "Syntax Error";
+        unit.diagnostic = *error.what() != '\0' ? error.what() : "Syntax Error";
+    }catch(const std::exception &error){
+        // code the back end cannot translate
+        unit.diagnostic = error.what();
+    }
+    source.reset();
+    close(fd);
+    std::ofstream file(unit.output, std::ios::binary);
+    file << output;
+    if(!file.flush()){
+        // keep the reason the unit failed to compile, if it did
+        unit.diagnostic += (unit.diagnostic.empty() ? "" : "; ") + ("Cannot write " + unit.output);
+    }
+}
+
+void BatchCompiler::Work_(size_t worker){
+    auto parser = MakeParser();
+    size_t unit;
+    while(Next_(worker, unit)){
+        Compile_(units_[unit], parser);
+    }
+}
+
+size_t BatchCompiler::Run(std::ostream &log){
+    GetTable();
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < queues_.size(); i ++){
+        workers.emplace_back(&BatchCompiler::Work_, this, i);
+    }
+    if(!queues_.empty()){
+        Work_(0);
+    }
+    for(auto &worker : workers){
+        worker.join();
+    }
+    size_t failed = 0;
+    for(auto &unit : units_){
+        if(!unit.diagnostic.empty()){
+            log << unit.source << ": " << unit.diagnostic << "\n";
+            failed ++;
+        }
+    }
+    return failed;
+}
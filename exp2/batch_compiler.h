@@ -0,0 +1,62 @@
+// batch_compiler.h
+#ifndef BATCH_COMPILER_H_
+#define BATCH_COMPILER_H_
+
+// Compiles many programs (units) at once on a pool of worker threads. The workers share
+// the lexer tables and the LR(1) table; each has its own parser and back end, so the
+// units do not see each other and the outputs do not depend on the number of workers.
+//
+// Each unit starts in the queue of one worker, in blocks of the manifest order; a worker
+// takes its units from the front of its queue and, when that is empty, steals from the
+// back of the others, so a few long units do not leave the other workers idle.
+//
+// A unit writes what `compiler UNIT` prints to its output file: the target code, or
+// "Syntax Error". A unit whose source cannot be read has no output file. The
+// diagnostics of the units are kept and printed in the manifest order.
+
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class SyntaxParser;
+
+class BatchCompiler {
+public:
+    struct Unit {
+        std::string source, output;
+        std::string diagnostic;     // empty if the unit compiled
+    };
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> units;
+    };
+
+    std::vector<Unit> units_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+
+    // the next unit for `worker`, its own or stolen; false when there is none left
+    bool Next_(size_t worker, size_t &unit);
+    void Work_(size_t worker);
+    void Compile_(Unit &unit, SyntaxParser &parser);
+
+public:
+    // `jobs` worker threads compile the units
+    BatchCompiler(std::vector<Unit> units, int jobs);
+
+    // Reads a manifest: a unit per line, its source path and, after a tab, its output
+    // path (the source path and ".asm" if there is none). Empty lines are skipped.
+    static std::vector<Unit> ReadManifest(std::istream &in);
+
+    // Compiles all units and prints the diagnostics of the failed ones to `log`,
+    // "source: message". Returns the number of failed units.
+    size_t Run(std::ostream &log);
+};
+
+#endif  // BATCH_COMPILER_H_
@@ -0,0 +1,133 @@
+#include "batch_lexer.h"
+#include "source_buffer.h"
+
+#include <algorithm>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+// closes a file descriptor on every way out of the scope
+struct FdGuard
+{
+    int fd;
+    ~FdGuard() { if(fd >= 0) close(fd); }
+};
+
+/**
+ * @brief Creates a pool of `threads` workers (0: one per hardware thread) that lex
+ *        with copies of `prototype`, as configured when this is constructed.
+ *
+ * @details The copies lex each file on one thread; the parallelism is across files.
+ */
+BatchLexer::BatchLexer(const LexicalAnalyzer &prototype, unsigned threads)
+    : prototype(prototype), num_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+    this->prototype.set_threads(1);
+    this->prototype.reset();
+}
+
+/**
+ * @brief Lexes every file of `paths` and writes the output of `format` for each of
+ *        them to `out`, in the order of `paths`.
+ *
+ * @return The number of files that could not be opened or read. Their output is an
+ *         error line instead, and the other files are lexed anyway.
+ */
+int BatchLexer::run(const std::vector<std::string> &paths, const Format &format, std::ostream &out)
+{
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> files;
+    };
+    unsigned workers = std::max(1u, (unsigned)std::min<size_t>(num_threads, paths.size()));
+    std::vector<Queue> queues(workers);
+    for(size_t i = 0; i < paths.size(); i ++){
+        queues[i % workers].files.push_back(i);
+    }
+
+    // outputs wait here until every file before them is written
+    std::mutex output_lock;
+    std::vector<std::string> outputs(paths.size());
+    std::vector<bool> done(paths.size());
+    size_t next_output = 0;
+    int failed = 0;
+
+    auto take = [&](unsigned self, size_t &file){
+        {
+            std::lock_guard<std::mutex> guard(queues[self].lock);
+            if(!queues[self].files.empty()){
+                file = queues[self].files.front();
+                queues[self].files.pop_front();
+                return true;
+            }
+        }
+        while(true){
+            // steal from the back of the longest queue; sizes are only a hint
+            unsigned victim = self;
+            size_t longest = 0;
+            for(unsigned w = 0; w < workers; w ++){
+                std::lock_guard<std::mutex> guard(queues[w].lock);
+                if(queues[w].files.size() > longest){
+                    longest = queues[w].files.size();
+                    victim = w;
+                }
+            }
+            if(longest == 0){
+                return false;
+            }
+            std::lock_guard<std::mutex> guard(queues[victim].lock);
+            if(!queues[victim].files.empty()){
+                file = queues[victim].files.back();
+                queues[victim].files.pop_back();
+                return true;
+            }
+        }
+    };
+
+    auto work = [&](unsigned self){
+        LexicalAnalyzer analyzer(prototype);
+        size_t file;
+        while(take(self, file)){
+            std::string output;
+            bool opened = true;
+            FdGuard fd{open(paths[file].c_str(), O_RDONLY)};
+            if(fd.fd < 0){
+                output = "Cannot open " + paths[file] + "\n";
+                opened = false;
+            }else{
+                // a read error (a directory, say) fails this file, not the batch
+                try{
+                    SourceBuffer source(fd.fd);
+                    analyzer.reset();
+                    int ret = analyzer.analyze(source);
+                    output = format(paths[file], source.contents(), analyzer, ret);
+                }catch(const std::exception &e){
+                    output = "Cannot read " + paths[file] + ": " + e.what() + "\n";
+                    opened = false;
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(output_lock);
+            failed += !opened;
+            outputs[file] = std::move(output);
+            done[file] = true;
+            for(; next_output < paths.size() && done[next_output]; next_output ++){
+                out << outputs[next_output];
+                std::string().swap(outputs[next_output]);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned w = 1; w < workers; w ++){
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for(auto &thread : threads){
+        thread.join();
+    }
+    return failed;
+}
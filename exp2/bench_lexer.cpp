@@ -0,0 +1,180 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include "corpus_generator.h"
+#include "static_dfa.h"
+
+/**
+ * @brief Throughput benchmark of LexicalAnalyzer::analyze.
+ *
+ * Usage: bench_lexer [--size N] [--mix NAME] [--seed N] [--rounds N] [--threads N] [file...]
+ *        bench_lexer [--size N] [--mix NAME] [--seed N] --write FILE
+ *
+ * The corpus is generated by CorpusGenerator: `--size` takes a byte count with an
+ * optional K, M or G suffix (default 16M), and `--mix` one of mixed, comment,
+ * identifier and number, or all (the default) for each of them in turn. Given
+ * files are benchmarked instead, each on its own. `--write` only writes the corpus
+ * to a file, a block at a time, for use with other tools.
+ *
+ * Every round lexes the whole corpus with a fresh copy of an analyzer on the static
+ * tables, as for a new source file; the best round is reported, as MB/s, tokens/s
+ * (tokens in the result, so comments are not counted) and heap allocations per
+ * token, counted by replacing the global operator new.
+ */
+
+static std::atomic<size_t> num_allocations{0};
+
+void *operator new(size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = std::malloc(size ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// a byte count with an optional K, M or G suffix
+static size_t parse_size(const std::string &text)
+{
+    size_t end;
+    size_t size = std::stoull(text, &end);
+    std::string unit = text.substr(end);
+    if(unit == "K"){
+        size <<= 10;
+    }else if(unit == "M"){
+        size <<= 20;
+    }else if(unit == "G"){
+        size <<= 30;
+    }else if(!unit.empty()){
+        throw std::invalid_argument("Unknown size unit \"" + unit + "\"");
+    }
+    return size;
+}
+
+static int run(const std::string &name, const std::string &corpus, int rounds, unsigned threads)
+{
+    LexicalAnalyzer prototype(get_static_dfa());
+    prototype.set_threads(threads);
+    double best = 1e30;
+    size_t tokens = 0, allocations = 0;
+    int ret = LexicalAnalyzer::OK;
+    for(int r = 0; r < rounds; r ++){
+        LexicalAnalyzer analyzer(prototype);
+        size_t before = num_allocations.load();
+        auto t0 = std::chrono::steady_clock::now();
+        ret = analyzer.analyze(corpus);
+        auto t1 = std::chrono::steady_clock::now();
+        allocations = num_allocations.load() - before;
+        tokens = analyzer.get_result().size();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    std::cout << std::left << std::setw(12) << name << std::right << std::setw(12) << corpus.size() << " bytes"
+              << std::setw(11) << tokens << " tokens" << std::fixed << std::setprecision(1)
+              << std::setw(9) << corpus.size() / best / 1e6 << " MB/s"
+              << std::setw(8) << tokens / best / 1e6 << " Mtokens/s" << std::setprecision(4)
+              << std::setw(9) << (tokens ? (double)allocations / tokens : 0.0) << " allocs/token";
+    if(ret != LexicalAnalyzer::OK){
+        std::cout << " (analyze returned " << ret << ")";
+    }
+    std::cout << std::defaultfloat << "\n";
+    return ret;
+}
+
+static int write_corpus(CorpusGenerator generator, const std::string &path)
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out){
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::string block;
+    while(generator.next(block)){
+        if(block.size() >= (1 << 20)){
+            out << block;
+            block.clear();
+        }
+    }
+    out << block;
+    return out ? 0 : 1;
+}
+
+int main(int argc, char *argv[]){
+    size_t size = 16 << 20;
+    uint64_t seed = 1;
+    int rounds = 5;
+    unsigned threads = 1;
+    std::string mix = "all", output;
+    std::vector<std::string> files;
+    try{
+        for(int i = 1; i < argc; i ++){
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if(arg == "--size" && has_value){
+                size = parse_size(argv[++ i]);
+            }else if(arg == "--mix" && has_value){
+                mix = argv[++ i];
+            }else if(arg == "--seed" && has_value){
+                seed = std::stoull(argv[++ i]);
+            }else if(arg == "--rounds" && has_value){
+                rounds = std::max(1, std::stoi(argv[++ i]));
+            }else if(arg == "--threads" && has_value){
+                threads = std::stoul(argv[++ i]);
+            }else if(arg == "--write" && has_value){
+                output = argv[++ i];
+            }else if(arg.rfind("--", 0) == 0){
+                std::cerr << "Usage: bench_lexer [--size N[K|M|G]] [--mix mixed|comment|identifier|number|all] [--seed N]"
+                             " [--rounds N] [--threads N] [--write FILE] [file...]\n";
+                return 1;
+            }else{
+                files.push_back(arg);
+            }
+        }
+        std::vector<CorpusGenerator::Mix> mixes;
+        if(mix == "all"){
+            mixes = {CorpusGenerator::MIXED, CorpusGenerator::COMMENTS, CorpusGenerator::IDENTIFIERS, CorpusGenerator::NUMBERS};
+        }else{
+            mixes = {CorpusGenerator::parse_mix(mix)};
+        }
+        if(!output.empty()){
+            if(mixes.size() != 1){
+                std::cerr << "--write needs one --mix\n";
+                return 1;
+            }
+            return write_corpus(CorpusGenerator(mixes[0], size, seed), output);
+        }
+
+        int failed = 0;
+        for(auto &path : files){
+            std::ifstream in(path, std::ios::binary);
+            if(!in){
+                std::cerr << "Cannot open " << path << "\n";
+                return 1;
+            }
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+            failed += run(path, buffer.str(), rounds, threads) != LexicalAnalyzer::OK;
+        }
+        for(int k = 0; k < mixes.size() && files.empty(); k ++){
+            std::string corpus = CorpusGenerator(mixes[k], size, seed).generate();
+            failed += run(CorpusGenerator::get_mix_name(mixes[k]), corpus, rounds, threads) != LexicalAnalyzer::OK;
+        }
+        return failed ? 1 : 0;
+    }catch(const std::exception &e){
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
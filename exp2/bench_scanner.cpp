@@ -0,0 +1,102 @@
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include "corpus_generator.h"
+#include "static_dfa.h"
+
+/**
+ * @brief Benchmark of the lexer configurations on the same corpus:
+ *        - table:  the DFA with keyword states, scanned through its tables
+ *        - direct: the same DFA, scanned by the code gen_scanner generated from it
+ *        - hash:   the DFA without keyword states, scanned through its tables, with
+ *                  keywords told apart from identifiers by the perfect hash
+ *        - direct hash: the same, scanned by its generated code
+ *
+ * Usage: bench_scanner [file...]
+ *
+ * The corpus is the concatenation of the given files. Without files two programs of
+ * 4 MiB from CorpusGenerator are used, a mixed one and an identifier-heavy one. Each
+ * configuration is timed twice: `scan` runs CompiledDFA::scan with a callback that
+ * only counts tokens (and looks identifiers up for `hash`), and `analyze` runs the
+ * whole LexicalAnalyzer, interning included. The best of several rounds is reported.
+ */
+
+static double best_seconds(int rounds, const std::function<void()> &run)
+{
+    double best = 1e30;
+    for(int r = 0; r < rounds; r ++){
+        auto t0 = std::chrono::steady_clock::now();
+        run();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+static void run(const std::string &name, const std::string &corpus)
+{
+    const unsigned char *data = (const unsigned char *)corpus.data();
+    CompiledDFA table = get_static_dfa();
+    CompiledDFA direct = table;
+    direct.set_direct_scanner(lexer_direct_scanner);
+    CompiledDFA identifier = get_static_identifier_dfa();
+    CompiledDFA direct_identifier = identifier;
+    direct_identifier.set_direct_scanner(identifier_direct_scanner);
+    KeywordSet keywords = get_static_keywords();
+    struct Config
+    {
+        const char *name;
+        CompiledDFA *dfa;
+        bool hash;
+    };
+
+    std::cout << name << " corpus: " << corpus.size() << " bytes\n";
+    const int rounds = 5;
+    for(auto config : {Config{"table", &table, false}, Config{"direct", &direct, false}, Config{"hash", &identifier, true},
+                        Config{"direct hash", &direct_identifier, true}}){
+        size_t tokens = 0, found = 0;
+        double scan = best_seconds(rounds, [&](){
+            tokens = found = 0;
+            config.dfa->scan(data, corpus.size(), ScanCursor(), [&](size_t first, size_t last, int attr){
+                if(config.hash && attr == identifier_kind){
+                    found += keywords.find(std::string_view(corpus).substr(first, last - first)) >= 0;
+                }
+                tokens ++;
+                return true;
+            });
+        });
+        LexicalAnalyzer analyzer(*config.dfa);
+        if(config.hash){
+            analyzer.set_keywords(keywords, identifier_kind);
+        }
+        double analyze = best_seconds(rounds, [&](){
+            analyzer.reset();
+            analyzer.analyze(corpus);
+        });
+        std::cout << config.name << " (" << config.dfa->get_num_states() << " states): scan "
+                  << corpus.size() / scan / 1e6 << " MB/s (" << scan * 1e9 / tokens << " ns/token), analyze "
+                  << corpus.size() / analyze / 1e6 << " MB/s, " << tokens << " tokens\n";
+    }
+}
+
+int main(int argc, char *argv[]){
+    std::string corpus;
+    for(int i = 1; i < argc; i ++){
+        std::ifstream in(argv[i], std::ios::binary);
+        if(!in){
+            std::cerr << "Cannot open " << argv[i] << "\n";
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        corpus += buffer.str();
+    }
+    if(argc > 1){
+        run("given", corpus);
+    }else{
+        run("mixed", CorpusGenerator(CorpusGenerator::MIXED, 4 << 20).generate());
+        run("identifier", CorpusGenerator(CorpusGenerator::IDENTIFIERS, 4 << 20).generate());
+    }
+    return 0;
+}
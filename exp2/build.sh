@@ -1,5 +1,3 @@
 #! /bin/bash
 
 make
-
-g++ main.cc -o Main -std=c++17
\ No newline at end of file
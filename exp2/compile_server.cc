@@ -0,0 +1,130 @@
+#include "compile_server.h"
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "back_end.h"
+#include "front_end.h"
+
+CompileServer::CompileServer(int jobs) : jobs_(jobs > 0 ? jobs : 1) {}
+
+bool CompileServer::ReadRequest_(std::istream &in, Request &request){
+    std::string line;
+    if(!std::getline(in, line)){
+        return false;
+    }
+    std::istringstream header(line);
+    long long length;
+    std::string rest;
+    if(!(header >> request.mode >> length) || header >> rest || length < 0 || length > MAX_PROGRAM_SIZE){
+        request.mode.clear();
+        request.program = "Bad request header: " + line;
+        return true;
+    }
+    request.program.resize(length);
+    if(!in.read(&request.program[0], length)){
+        request.mode.clear();
+        request.program = "The program ends after " + std::to_string(in.gcount()) + " of " + std::to_string(length) + " bytes";
+    }
+    return true;
+}
+
+std::string CompileServer::Respond_(const Request &request, SyntaxParser &parser){
+    std::string status = "ok", body;
+    if(request.mode == "asm" || request.mode == "ir"){
+        try{
+            ICode icode = ParseProgram(request.program, parser);
+            if(request.mode == "ir"){
+                std::ostringstream out;
+                Output(icode, out);
+                body = out.str();
+            }else{
+                body = GenerateCode(icode);
+            }
+        }catch(const SyntaxError &error){
+            status = "error";
+            body = *error.what() != '\0' ? error.what() : "Syntax Error";
+        }catch(const std::exception &error){
+            status = "error";
+            body = error.what();
+        }
+    }else{
+        status = "error";
+        body = request.mode.empty() ? request.program : "Unknown mode " + request.mode;
+    }
+    return status + " " + std::to_string(body.size()) + "\n" + body;
+}
+
+void CompileServer::Work_(){
+    auto parser = MakeParser();
+    while(true){
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&](){ return !requests_.empty() || end_; });
+            if(requests_.empty()){
+                return;
+            }
+            request = std::move(requests_.front());
+            requests_.pop_front();
+        }
+        std::string response = Respond_(request, parser);
+        std::lock_guard<std::mutex> lock(mutex_);
+        responses_.emplace(request.id, std::move(response));
+        changed_.notify_all();
+    }
+}
+
+void CompileServer::Write_(std::ostream &out){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true){
+        changed_.wait(lock, [&](){
+            return responses_.count(num_written_) != 0 || (end_ && num_written_ == num_requests_);
+        });
+        auto it = responses_.find(num_written_);
+        if(it == responses_.end()){
+            return;
+        }
+        std::string response = std::move(it->second);
+        responses_.erase(it);
+        // the client may wait for this response before it sends the next request
+        lock.unlock();
+        out << response;
+        out.flush();
+        lock.lock();
+        num_written_ ++;
+        changed_.notify_all();
+    }
+}
+
+void CompileServer::Serve(std::istream &in, std::ostream &out){
+    GetTable();
+    // `out` belongs to the writer thread: reading must not flush it, as std::cin does std::cout
+    in.tie(nullptr);
+    std::vector<std::thread> workers;
+    for(int i = 0; i < jobs_; i ++){
+        workers.emplace_back(&CompileServer::Work_, this);
+    }
+    std::thread writer(&CompileServer::Write_, this, std::ref(out));
+
+    Request request;
+    bool more = true;
+    while(more && ReadRequest_(in, request)){
+        // after a request that cannot be read, where the next one starts is not known
+        more = !request.mode.empty();
+        std::unique_lock<std::mutex> lock(mutex_);
+        // a few requests per worker in flight, so a fast client does not fill the memory
+        changed_.wait(lock, [&](){ return num_requests_ - num_written_ < 4 * (size_t)jobs_; });
+        request.id = num_requests_ ++;
+        requests_.push_back(std::move(request));
+        changed_.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        end_ = true;
+        changed_.notify_all();
+    }
+    for(auto &worker : workers){
+        worker.join();
+    }
+    writer.join();
+}
@@ -0,0 +1,64 @@
+// compile_server.h
+#ifndef COMPILE_SERVER_H_
+#define COMPILE_SERVER_H_
+
+// A long-running compiler for many small programs. The lexer tables, the LR(1) table and
+// a parser per worker thread are set up once, then each program is only lexed, parsed
+// and translated.
+//
+// The programs arrive on a stream, each as a header line and the bytes of the program:
+//
+//     asm 27\n<27 bytes>      compile to target code
+//     ir 27\n<27 bytes>       only to intermediate code, as Main prints it
+//
+// and every request gets one response, in the order of the requests:
+//
+//     ok 120\n<120 bytes>     the target code or intermediate code
+//     error 14\n<14 bytes>    the syntax error, "2:5: unexpected x" or "Syntax Error"
+//
+// A header that cannot be read, or with a length over MAX_PROGRAM_SIZE, gets an error
+// response and ends the stream.
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+class SyntaxParser;
+
+class CompileServer {
+private:
+    struct Request {
+        size_t id;
+        std::string mode, program;
+    };
+
+    int jobs_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Request> requests_;
+    std::map<size_t, std::string> responses_;   // done, not written yet
+    size_t num_requests_ = 0, num_written_ = 0;
+    bool end_ = false;
+
+    // false at the end of the stream; a request that cannot be read has no mode
+    bool ReadRequest_(std::istream &in, Request &request);
+    std::string Respond_(const Request &request, SyntaxParser &parser);
+    void Work_();
+    void Write_(std::ostream &out);
+
+public:
+    static constexpr long long MAX_PROGRAM_SIZE = 64 << 20;
+
+    // `jobs` worker threads compile the programs
+    explicit CompileServer(int jobs);
+
+    // Serves the requests on `in` until its end
+    void Serve(std::istream &in, std::ostream &out);
+};
+
+#endif  // COMPILE_SERVER_H_
@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include "back_end.h"
+#include "batch_compiler.h"
+#include "compile_server.h"
+#include "front_end.h"
+#include "source_buffer.h"
+
+// The stream for a dump flag: none without a path, stdout for "-", or `file`
+std::ostream *OpenDump(const std::string &path, std::ofstream &file){
+    if(path.empty()){
+        return nullptr;
+    }
+    if(path == "-"){
+        return &std::cout;
+    }
+    file.open(path);
+    if(!file){
+        std::cerr << "Cannot open " << path << std::endl;
+        return nullptr;
+    }
+    return &file;
+}
+
+// Compiles a program to target code in one process: the tokens, the intermediate
+// code and the symbol table are passed on in memory, not as text between Main (exp2)
+// and exp3. The program is the file given on the command line, or stdin.
+//
+// --dump-tokens FILE writes the tokens as lex prints them, and --dump-ir FILE the
+// intermediate code as Main prints it; "-" is stdout, before the target code.
+//
+// --serve compiles the programs of the requests on stdin instead, and --batch MANIFEST
+// the programs listed in MANIFEST ("-" is stdin), each to its own output file; both on
+// --jobs N threads (the number of cores by default), see compile_server.h and
+// batch_compiler.h. --batch exits with 1 if a program failed.
+int main(int argc, char *argv[]){
+    std::string tokens_path, ir_path, manifest_path;
+    bool serve = false;
+    int jobs = std::thread::hardware_concurrency();
+    int arg = 1;
+    for(; arg < argc && std::string(argv[arg]).rfind("--", 0) == 0; arg ++){
+        std::string option = argv[arg];
+        if(option == "--dump-tokens" && arg + 1 < argc){
+            tokens_path = argv[++ arg];
+        }else if(option == "--dump-ir" && arg + 1 < argc){
+            ir_path = argv[++ arg];
+        }else if(option == "--serve"){
+            serve = true;
+        }else if(option == "--batch" && arg + 1 < argc){
+            manifest_path = argv[++ arg];
+        }else if(option == "--jobs" && arg + 1 < argc && std::atoi(argv[arg + 1]) > 0){
+            jobs = std::atoi(argv[++ arg]);
+        }else{
+            std::cerr << "Usage: compiler [--dump-tokens FILE] [--dump-ir FILE] [program]" << std::endl;
+            std::cerr << "       compiler --serve [--jobs N]" << std::endl;
+            std::cerr << "       compiler --batch MANIFEST [--jobs N]" << std::endl;
+            return 1;
+        }
+    }
+    if((serve || !manifest_path.empty()) && (arg < argc || !tokens_path.empty() || !ir_path.empty() || (serve && !manifest_path.empty()))){
+        std::cerr << "--serve and --batch take no program and no dumps" << std::endl;
+        return 1;
+    }
+    if(!manifest_path.empty()){
+        std::ifstream manifest_file;
+        if(manifest_path != "-"){
+            manifest_file.open(manifest_path);
+            if(!manifest_file){
+                std::cerr << "Cannot open " << manifest_path << std::endl;
+                return 1;
+            }
+        }
+        auto units = BatchCompiler::ReadManifest(manifest_path == "-" ? std::cin : manifest_file);
+        return BatchCompiler(units, jobs).Run(std::cerr) == 0 ? 0 : 1;
+    }
+    if(serve){
+        std::ios::sync_with_stdio(false);
+        CompileServer(jobs).Serve(std::cin, std::cout);
+        return 0;
+    }
+
+    std::ofstream tokens_file, ir_file;
+    std::ostream *tokens_dump = OpenDump(tokens_path, tokens_file);
+    std::ostream *ir_dump = OpenDump(ir_path, ir_file);
+    if((!tokens_path.empty() && tokens_dump == nullptr) || (!ir_path.empty() && ir_dump == nullptr)){
+        return 1;
+    }
+
+    int fd = STDIN_FILENO;
+    if(arg < argc && (fd = open(argv[arg], O_RDONLY)) < 0){
+        std::cerr << "Cannot open " << argv[arg] << std::endl;
+        return 1;
+    }
+    // the buffer owns the text, so it lives until the end of main
+    std::unique_ptr<SourceBuffer> source;
+    std::string_view text;
+    try{
+        source = std::make_unique<SourceBuffer>(fd);
+        text = ReadProgram(*source);
+    }catch(const std::exception &error){
+        // a program that cannot be read, such as a directory
+        std::cerr << (arg < argc ? argv[arg] : "stdin") << ": " << error.what() << std::endl;
+        return 1;
+    }
+
+    auto parser = MakeParser();
+    ICode icode;
+    try{
+        icode = ParseProgram(text, parser, tokens_dump);
+    }catch(const SyntaxError &error){
+        ReportSyntaxError(error);
+        return 0;
+    }
+    if(ir_dump != nullptr){
+        Output(icode, *ir_dump);
+        ir_dump->flush();
+    }
+    try{
+        std::cout << GenerateCode(icode);
+    }catch(const std::exception &error){
+        // intermediate code the back end has no translation for
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "back_end.h"
+#include "batch_compiler.h"
+#include "compile_server.h"
+#include "corpus_generator.h"
+#include "front_end.h"
+#include "../exp3/ir_file.h"
+
+// Consistency checks of the compiler, run by `make check` from this directory (the
+// LR(1) table is read from table.csv).
+//
+// Usage: compiler_check [--seed N]
+//
+// Each check compiles programs of CorpusGenerator in two ways that have to give the
+// same result. A check that fails prints the first differences; the exit status is 1
+// if any check failed.
+
+// Prints a failure of `check`, the first few of each check only, with the expected and
+// actual text from the line where they differ
+int Report(const char *check, int failures, const std::string &what, const std::string &expected, const std::string &actual){
+    if(failures <= 3){
+        size_t pos = 0;
+        while(pos < expected.size() && pos < actual.size() && expected[pos] == actual[pos]){
+            pos ++;
+        }
+        pos = pos == 0 ? 0 : expected.rfind('\n', pos - 1) + 1;
+        std::cout << check << ": " << what << "\n  expected: " << expected.substr(pos, 200)
+                  << "\n  actual:   " << actual.substr(pos, 200) << std::endl;
+    }
+    return failures;
+}
+
+// A random program of about `size` bytes
+std::string RandomProgram(std::mt19937 &random, size_t size){
+    return CorpusGenerator(CorpusGenerator::MIXED, size, random()).generate();
+}
+
+// OutputBinary and IRFile: the binary intermediate code reads back as the text Output
+// writes, and a truncated file is refused
+int CheckIRFile(std::mt19937 &random){
+    int failures = 0;
+    char path[] = "/tmp/compiler_check_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0){
+        return Report("ir-file", ++ failures, "cannot create a temporary file", path, "");
+    }
+    auto parser = MakeParser();
+    for(int i = 0; i < 40; i ++){
+        std::string program = RandomProgram(random, 200 + random() % 20000);
+        ICode icode;
+        try{
+            icode = ParseProgram(program, parser);
+        }catch(const std::exception &error){
+            Report("ir-file", ++ failures, "program " + std::to_string(i) + " does not parse", "", error.what());
+            continue;
+        }
+        std::ostringstream expected, actual;
+        Output(icode, expected);
+        if(ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0){
+            Report("ir-file", ++ failures, "cannot truncate " + std::string(path), "", "");
+            break;
+        }
+        OutputBinary(icode, fd);
+        try{
+            IRFile(fd).WriteText(actual);
+        }catch(const std::exception &error){
+            Report("ir-file", ++ failures, "program " + std::to_string(i) + " does not read back", expected.str(), error.what());
+            continue;
+        }
+        if(actual.str() != expected.str()){
+            Report("ir-file", ++ failures, "program " + std::to_string(i) + " reads back different", expected.str(), actual.str());
+        }
+        off_t size = lseek(fd, 0, SEEK_END);
+        if(ftruncate(fd, size - 1 - random() % (size - 1)) != 0){
+            continue;
+        }
+        try{
+            IRFile file(fd);
+            Report("ir-file", ++ failures, "program " + std::to_string(i) + " reads back truncated", "an error", "");
+        }catch(const std::invalid_argument &){
+        }
+    }
+    close(fd);
+    unlink(path);
+    return failures;
+}
+
+// A request of the compile server for `program`
+std::string Request(const std::string &mode, const std::string &program){
+    return mode + " " + std::to_string(program.size()) + "\n" + program;
+}
+
+// What the compile server answers to a request for `program`, compiled with `parser`
+std::string ExpectedResponse(const std::string &mode, const std::string &program, SyntaxParser &parser){
+    std::string status = "ok", body;
+    try{
+        ICode icode = ParseProgram(program, parser);
+        if(mode == "ir"){
+            std::ostringstream out;
+            Output(icode, out);
+            body = out.str();
+        }else{
+            body = GenerateCode(icode);
+        }
+    }catch(const std::exception &error){
+        status = "error";
+        body = *error.what() != '\0' ? error.what() : "Syntax Error";
+    }
+    return status + " " + std::to_string(body.size()) + "\n" + body;
+}
+
+// CompileServer: the responses to a stream of requests are those of compiling each
+// program alone, in order; a request with a bad mode or a syntax error gets an error
+// response, and a header that cannot be read or a program shorter than its length one
+// error response that ends the stream
+int CheckServer(std::mt19937 &random){
+    int failures = 0;
+    auto parser = MakeParser();
+    std::string requests, expected;
+    for(int i = 0; i < 30; i ++){
+        std::string mode = random() % 2 ? "asm" : "ir";
+        std::string program = RandomProgram(random, 100 + random() % 5000);
+        if(i % 7 == 3){
+            // a syntax error somewhere in the program
+            program.insert(random() % program.size(), "} ;");
+        }
+        requests += Request(mode, program);
+        expected += ExpectedResponse(mode, program, parser);
+        if(i % 10 == 5){
+            requests += Request("obj", program);
+            expected += "error 16\nUnknown mode obj";
+        }
+    }
+    for(int jobs : {1, 4}){
+        std::istringstream in(requests);
+        std::ostringstream out;
+        CompileServer(jobs).Serve(in, out);
+        if(out.str() != expected){
+            Report("server", ++ failures, std::to_string(jobs) + " jobs answer different", expected, out.str());
+        }
+    }
+
+    std::string valid = RandomProgram(random, 300);
+    const std::string bad_requests[] = {
+        "asm -1\n",
+        "asm " + std::to_string(CompileServer::MAX_PROGRAM_SIZE + 1) + "\n",
+        "asm 99999999999999999999\n",
+        "asm x\n",
+        "asm\n",
+        "asm 3 4\n",
+        "asm 100000\nint x;",
+    };
+    for(auto &bad : bad_requests){
+        std::istringstream in(Request("asm", valid) + bad + Request("ir", valid));
+        std::ostringstream out;
+        CompileServer(2).Serve(in, out);
+        std::string first = ExpectedResponse("asm", valid, parser);
+        std::string response = out.str();
+        std::string rest = response.substr(std::min(first.size(), response.size()));
+        std::string status = rest.substr(0, rest.find(' '));
+        size_t newline = rest.find('\n');
+        long long length = newline == std::string::npos ? -1 : std::atoll(rest.c_str() + status.size());
+        if(response.compare(0, first.size(), first) != 0 || status != "error" || length < 0 || rest.size() != newline + 1 + length){
+            std::string request = bad.substr(0, bad.find('\n'));
+            Report("server", ++ failures, "request \"" + request + "\" is not answered with one error that ends the stream",
+                   first + "error ...", response);
+        }
+    }
+    return failures;
+}
+
+// What `compiler UNIT` writes for `program`, compiled with `parser`
+std::string ExpectedOutput(const std::string &program, SyntaxParser &parser){
+    try{
+        return GenerateCode(ParseProgram(program, parser));
+    }catch(const SyntaxError &){
+        return "Syntax Error";
+    }catch(const std::exception &){
+        return "";
+    }
+}
+
+// BatchCompiler: each output file is what compiling its program alone gives, on any
+// number of workers, and a unit whose source cannot be read has no output file, even
+// one left from an earlier run
+int CheckBatch(std::mt19937 &random){
+    int failures = 0;
+    char dir[] = "/tmp/compiler_check_XXXXXX";
+    if(mkdtemp(dir) == nullptr){
+        return Report("batch", ++ failures, "cannot create a temporary directory", dir, "");
+    }
+    auto parser = MakeParser();
+    std::vector<BatchCompiler::Unit> units;
+    std::vector<std::string> expected;
+    for(int i = 0; i < 24; i ++){
+        std::string program = RandomProgram(random, 100 + random() % (i % 8 == 0 ? 50000 : 3000));
+        if(i % 5 == 2){
+            program.insert(random() % program.size(), "} ;");
+        }
+        std::string path = std::string(dir) + "/" + std::to_string(i);
+        std::ofstream(path, std::ios::binary) << program;
+        units.push_back({path, path + ".asm", ""});
+        expected.push_back(ExpectedOutput(program, parser));
+    }
+    // a missing source and a directory, with outputs from an earlier run
+    for(std::string source : {std::string(dir) + "/missing", std::string(dir)}){
+        std::string output = std::string(dir) + "/unreadable" + std::to_string(units.size()) + ".asm";
+        units.push_back({source, output, ""});
+        expected.push_back("");
+    }
+    for(int jobs : {1, 3}){
+        for(size_t i = 24; i < units.size(); i ++){
+            std::ofstream(units[i].output) << "stale";
+        }
+        std::ostringstream log;
+        size_t failed = BatchCompiler(units, jobs).Run(log);
+        size_t expected_failed = 0;
+        for(size_t i = 0; i < units.size(); i ++){
+            std::ifstream file(units[i].output, std::ios::binary);
+            std::string output((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            std::string what = "unit " + std::to_string(i) + " on " + std::to_string(jobs) + " jobs";
+            if(i >= 24){
+                expected_failed ++;
+                if(file){
+                    Report("batch", ++ failures, what + " has an output, its source cannot be read", "no file", output);
+                }
+                continue;
+            }
+            expected_failed += expected[i] == "Syntax Error" || expected[i].empty();
+            if(output != expected[i]){
+                Report("batch", ++ failures, what + " differs from a single compile", expected[i], output);
+            }
+        }
+        if(failed != expected_failed){
+            Report("batch", ++ failures, "the number of failed units on " + std::to_string(jobs) + " jobs differs",
+                   std::to_string(expected_failed), std::to_string(failed) + "\n" + log.str());
+        }
+    }
+    for(auto &unit : units){
+        unlink(unit.output.c_str());
+        unlink(unit.source.c_str());
+    }
+    rmdir(dir);
+    return failures;
+}
+
+int main(int argc, char *argv[]){
+    unsigned seed = 1;
+    if(argc == 3 && std::string(argv[1]) == "--seed"){
+        seed = std::strtoul(argv[2], nullptr, 10);
+    }else if(argc != 1){
+        std::cerr << "Usage: compiler_check [--seed N]" << std::endl;
+        return 2;
+    }
+
+    struct Check {
+        const char *name;
+        int (*run)(std::mt19937 &);
+    };
+    const Check checks[] = {
+        {"ir-file", CheckIRFile},
+        {"server", CheckServer},
+        {"batch", CheckBatch},
+    };
+    int failed = 0;
+    for(auto &check : checks){
+        std::mt19937 random(seed);
+        int failures = check.run(random);
+        std::cout << std::left << std::setw(12) << check.name << " " << (failures ? "FAILED" : "ok");
+        if(failures){
+            std::cout << " (" << failures << ", seed " << seed << ")";
+        }
+        std::cout << std::endl;
+        failed += failures > 0;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,334 @@
+#include "corpus_generator.h"
+#include "my_dfa.h"
+
+#include <stdexcept>
+
+static const char *mix_names[] = {"mixed", "comment", "identifier", "number"};
+
+// comment words; a few of them are not ASCII
+static const char *words[] = {
+    "the", "loop", "counts", "down", "to", "zero", "and", "then", "stops", "each", "value", "is", "read", "once",
+    "before", "after", "total", "rate", "index", "see", "above", "note:", "TODO", "fixed", "in", "v2", "(not", "yet)",
+    "x*y", "a/b", "1.5e3", "#3", "@param", "caf\xc3\xa9", "na\xc3\xafve", "\xe2\x86\x92", "\xe6\x97\xa5\xe6\x9c\xac",
+    "\xe2\x88\x91", "\xf0\x9f\x99\x82",
+};
+static constexpr int NUM_WORDS = sizeof(words) / sizeof(words[0]);
+static constexpr int NUM_ASCII_WORDS = NUM_WORDS - 6;
+
+static const char *relations[] = {"==", "!=", "<", "<=", ">", ">="};
+static const char *arithmetic[] = {"+", "-", "*", "/"};
+
+/**
+ * @brief Creates a generator of a program of `size` bytes. The shortest program, one
+ *        declaration and an empty block, takes up to 30 bytes whatever the size.
+ */
+CorpusGenerator::CorpusGenerator(Mix mix, size_t size, uint64_t seed) :
+    mix(mix), size(size), written(0), random_state(seed), stage(DECLARATIONS), next_declared(0)
+{
+    // a pool of names, declared for as long as they take at most a quarter of the size
+    int num_names = mix == IDENTIFIERS ? 2048 : 48;
+    while(names.size() < num_names){
+        std::string name = make_name();
+        bool taken = false;
+        for(auto kw : keywords){
+            taken = taken || name == kw;
+        }
+        for(int k = 0; k < names.size() && !taken; k ++){
+            taken = names[k] == name;
+        }
+        if(!taken){
+            names.push_back(name);
+        }
+    }
+}
+
+// splitmix64
+uint64_t CorpusGenerator::random()
+{
+    uint64_t z = (random_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+size_t CorpusGenerator::random_below(size_t bound)
+{
+    return random() % bound;
+}
+
+bool CorpusGenerator::chance(int percent)
+{
+    return random_below(100) < percent;
+}
+
+std::string CorpusGenerator::make_name()
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char digits[] = "0123456789";
+    std::string name;
+    int length;
+    if(mix == IDENTIFIERS){
+        // keyword prefixes keep the keyword states busy until the last character
+        if(chance(40)){
+            name = keywords[random_below(keywords.size())];
+        }
+        length = 4 + random_below(13);
+    }else{
+        length = 1 + random_below(3);
+    }
+    if(name.empty()){
+        name += letters[random_below(52)];
+    }
+    while(name.size() < length){
+        name += chance(75) ? letters[random_below(52)] : digits[random_below(10)];
+    }
+    return name;
+}
+
+int CorpusGenerator::append_number()
+{
+    int digits = mix == NUMBERS ? 1 + random_below(9) : 1 + random_below(4);
+    if(chance(15)){
+        line += '0';
+    }else{
+        line += (char)('1' + random_below(9));
+        for(int k = 1; k < digits; k ++){
+            line += (char)('0' + random_below(10));
+        }
+    }
+    if(chance(mix == NUMBERS ? 50 : 25)){
+        line += '.';
+        int fraction = 1 + random_below(mix == NUMBERS ? 6 : 2);
+        for(int k = 0; k < fraction; k ++){
+            line += (char)('0' + random_below(10));
+        }
+    }
+    return 0;
+}
+
+int CorpusGenerator::append_factor(int depth)
+{
+    int numbers = mix == NUMBERS ? 75 : (mix == IDENTIFIERS ? 5 : 30);
+    if(depth < 2 && chance(10)){
+        line += '(';
+        append_expression(depth + 1);
+        line += ')';
+    }else if(chance(4)){
+        line += "- ";
+        append_factor(depth);
+    }else if(chance(numbers)){
+        append_number();
+    }else{
+        line += names[random_below(next_declared)];
+    }
+    return 0;
+}
+
+int CorpusGenerator::append_expression(int depth)
+{
+    int factors = 1 + random_below(mix == NUMBERS ? 8 : 4);
+    append_factor(depth);
+    for(int k = 1; k < factors; k ++){
+        // no space before or after an operator sometimes; a factor never starts with
+        // '*' or '/', so this cannot open a comment
+        bool tight = chance(20);
+        line += tight ? "" : " ";
+        line += arithmetic[random_below(4)];
+        line += tight ? "" : " ";
+        append_factor(depth);
+    }
+    return 0;
+}
+
+int CorpusGenerator::append_condition()
+{
+    int terms = 1 + random_below(3);
+    for(int k = 0; k < terms; k ++){
+        if(k > 0){
+            line += chance(50) ? " && " : " || ";
+        }
+        bool negate = chance(10);
+        line += negate ? "!(" : "";
+        for(int side = 0; side < 2; side ++){
+            if(side == 1){
+                line += ' ';
+                line += relations[random_below(6)];
+                line += ' ';
+            }
+            if(chance(mix == NUMBERS ? 60 : 30)){
+                append_number();
+            }else{
+                line += names[random_below(next_declared)];
+            }
+        }
+        line += negate ? ")" : "";
+    }
+    return 0;
+}
+
+// a statement without its ';', on as many lines as it needs
+int CorpusGenerator::append_statement(int depth)
+{
+    std::string indent(4 * (depth + 1), ' ');
+    int kind = random_below(100);
+    if(mix == NUMBERS || mix == IDENTIFIERS){
+        kind = kind < 60 ? 0 : kind;
+    }
+    if(depth >= 2 && kind >= 55 && kind < 95){
+        kind = 0;
+    }
+    if(kind < 45){
+        line += names[random_below(next_declared)];
+        line += " = ";
+        append_expression(0);
+    }else if(kind < 55 || kind >= 95){
+        line += kind < 55 ? "scanf(" : "printf(";
+        int args = 1 + random_below(mix == IDENTIFIERS ? 6 : 3);
+        for(int k = 0; k < args; k ++){
+            line += k > 0 ? ", " : "";
+            line += names[random_below(next_declared)];
+        }
+        line += ')';
+    }else if(kind < 70){
+        line += "if ";
+        append_condition();
+        line += " then ";
+        append_statement(depth + 1);
+    }else if(kind < 85){
+        line += "while ";
+        append_condition();
+        line += " do ";
+        append_statement(depth + 1);
+    }else{
+        line += "{\n";
+        int statements = 1 + random_below(4);
+        for(int k = 0; k < statements; k ++){
+            line += indent + "    ";
+            append_statement(depth + 1);
+            line += ";\n";
+        }
+        line += indent + "}";
+    }
+    return 0;
+}
+
+int CorpusGenerator::append_comment()
+{
+    // the words after the ASCII ones are multibyte UTF-8
+    int num_words = mix == COMMENTS ? NUM_WORDS : NUM_ASCII_WORDS;
+    if(chance(50)){
+        line += "    //";
+        int count = 1 + random_below(12);
+        for(int k = 0; k < count; k ++){
+            line += ' ';
+            line += words[random_below(num_words)];
+        }
+    }else{
+        line += "    /*";
+        int lines = mix == COMMENTS ? 1 + random_below(6) : 1;
+        for(int l = 0; l < lines; l ++){
+            line += l > 0 ? "\n     *" : "";
+            int count = 1 + random_below(10);
+            for(int k = 0; k < count; k ++){
+                line += ' ';
+                line += words[random_below(num_words)];
+            }
+        }
+        line += lines > 1 ? "\n     */" : " */";
+    }
+    line += '\n';
+    return 0;
+}
+
+// the next line, or block of lines, of the program
+int CorpusGenerator::append_line(std::string &out)
+{
+    line.clear();
+    if(stage == DECLARATIONS){
+        bool first = next_declared == 0;
+        line += chance(70) ? "int " : "double ";
+        int count = first ? 1 : 1 + random_below(8);
+        for(int k = 0; k < count && next_declared + k < names.size(); k ++){
+            line += k > 0 ? ", " : "";
+            line += names[next_declared + k];
+        }
+        line += ";\n";
+        // room for this line, "{\n", ";}\n" and a quarter of the program for the rest
+        if(first || (next_declared < names.size() && written + line.size() + 5 <= size / 4)){
+            next_declared = std::min(names.size(), next_declared + count);
+        }else{
+            line = "{\n";
+            stage = STATEMENTS;
+        }
+    }else if(stage == STATEMENTS){
+        if(chance(mix == COMMENTS ? 75 : 10)){
+            append_comment();
+        }else{
+            line += "    ";
+            append_statement(0);
+            line += ";\n";
+        }
+        if(written + line.size() + 3 > size){
+            // close the block; the ';' is its last, empty statement
+            line = ";}\n";
+            stage = PADDING;
+        }
+    }else if(stage == PADDING){
+        if(written < size){
+            line.assign(size - written - 1, ' ');
+            line += '\n';
+        }
+        stage = DONE;
+    }
+    out += line;
+    written += line.size();
+    return 0;
+}
+
+/**
+ * @brief Appends the next part of the program to `out`: a line, or a statement that
+ *        spans several lines.
+ *
+ * @return False, without appending anything, once the whole program has been
+ *         generated.
+ */
+bool CorpusGenerator::next(std::string &out)
+{
+    if(stage == DONE){
+        return false;
+    }
+    append_line(out);
+    return true;
+}
+
+/**
+ * @brief Returns the whole program.
+ */
+std::string CorpusGenerator::generate()
+{
+    std::string out;
+    out.reserve(size);
+    while(next(out)){
+    }
+    return out;
+}
+
+/**
+ * @brief Returns the mix named `name` ("mixed", "comment", "identifier" or "number").
+ *
+ * @throws std::invalid_argument If there is no mix of that name.
+ */
+CorpusGenerator::Mix CorpusGenerator::parse_mix(std::string_view name)
+{
+    for(int m = MIXED; m <= NUMBERS; m ++){
+        if(name == mix_names[m]){
+            return (Mix)m;
+        }
+    }
+    throw std::invalid_argument("Unknown corpus mix \"" + std::string(name) + "\"");
+}
+
+const char *CorpusGenerator::get_mix_name(Mix mix)
+{
+    return mix_names[mix];
+}
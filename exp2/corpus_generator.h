@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Generates benchmark input: programs in the token language of my_dfa.h, of
+ *        an exact size, that lex without errors.
+ *
+ * A program is a list of declarations followed by one `{ ... }` block of statements
+ * (assignments, `if ... then`, `while ... do`, `scanf`, `printf`, nested blocks) and
+ * comments, as the grammar of exp2 expects; whitespace after the closing brace pads
+ * it to the requested size. The mix decides what most of the bytes are:
+ *   - MIXED:       all statement kinds, short names, a comment now and then
+ *   - COMMENTS:    mostly block and line comments, some with UTF-8 text
+ *   - IDENTIFIERS: long names, many of them starting with a keyword
+ *   - NUMBERS:     arithmetic on integer and floating point literals
+ *
+ * The output depends only on the mix, the size and the seed, on every platform: the
+ * generator uses its own random number generator, not <random>. It is produced one
+ * line at a time with `next`, so a corpus larger than memory can be streamed to a
+ * file.
+ */
+class CorpusGenerator
+{
+    public:
+        enum Mix { MIXED, COMMENTS, IDENTIFIERS, NUMBERS };
+
+    private:
+        enum Stage { DECLARATIONS, STATEMENTS, PADDING, DONE };
+
+        Mix mix;
+        size_t size, written;
+        uint64_t random_state;
+        Stage stage;
+        std::vector<std::string> names;
+        size_t next_declared;
+        std::string line;
+
+        uint64_t random();
+        size_t random_below(size_t bound);
+        bool chance(int percent);
+        std::string make_name();
+        int append_number();
+        int append_factor(int depth);
+        int append_expression(int depth);
+        int append_condition();
+        int append_statement(int depth);
+        int append_comment();
+        int append_line(std::string &out);
+
+    public:
+        CorpusGenerator(Mix, size_t size, uint64_t seed = 1);
+        bool next(std::string &out);
+        std::string generate();
+        static Mix parse_mix(std::string_view);
+        static const char *get_mix_name(Mix);
+};
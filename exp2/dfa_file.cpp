@@ -0,0 +1,203 @@
+#include "lexical_analysis.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+/**
+ * Binary file format of a CompiledDFA.
+ *
+ * A DFAFileHeader is followed by the arrays of the table, each one starting at a
+ * multiple of 8 bytes: byte_class[257] (the last one for MULTIBYTE),
+ * table[num_states * num_classes], attrs[num_states], accel[num_states] and
+ * inner_states[num_inner_states], stored exactly as they are in memory. A loaded
+ * file is mapped and the CompiledDFA points straight into the mapping, so loading
+ * costs one validation pass over a few kilobytes and nothing is parsed or copied.
+ *
+ * Integers are stored in the byte order of the machine that wrote the file; a file
+ * from a machine with the other order, an older format version, or a file that was
+ * truncated or changed (the checksum covers everything after the header) is refused.
+ */
+struct DFAFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t num_states, num_classes, num_inner_states;
+    uint32_t checksum;              // FNV-1a of the bytes after the header
+    uint64_t size;                  // of the whole file
+};
+
+static constexpr char DFA_FILE_MAGIC[8] = {'L', 'E', 'X', 'D', 'F', 'A', '\r', '\n'};
+static constexpr uint32_t DFA_FILE_VERSION = 2;      // 2: byte_class has the MULTIBYTE slot
+static constexpr uint32_t DFA_FILE_BYTE_ORDER = 0x01020304;
+
+static_assert(std::is_trivially_copyable<ScanRule>::value, "ScanRule is stored as raw bytes");
+static_assert(sizeof(DFAFileHeader) % 8 == 0, "the first array must start aligned");
+
+// offsets of the arrays for the given counts, and the size of the file
+struct DFAFileLayout
+{
+    size_t byte_class, table, attrs, accel, inner_states, size;
+
+    DFAFileLayout(size_t num_states, size_t num_classes, size_t num_inner_states)
+    {
+        auto align = [](size_t offset){
+            return (offset + 7) & ~(size_t)7;
+        };
+        byte_class = sizeof(DFAFileHeader);
+        table = align(byte_class + CompiledDFA::MULTIBYTE + 1);
+        attrs = align(table + num_states * num_classes * sizeof(uint16_t));
+        accel = align(attrs + num_states * sizeof(int));
+        inner_states = align(accel + num_states * sizeof(ScanRule));
+        size = align(inner_states + num_inner_states * sizeof(uint16_t));
+    }
+};
+
+static uint32_t dfa_file_checksum(const unsigned char *p, const unsigned char *end)
+{
+    uint32_t hash = 2166136261u;
+    for(; p < end; p ++){
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes the table to `path` in the format described above.
+ *
+ * @details The file is written under a temporary name and renamed into place, so a
+ *          process that loads `path` at the same time sees either the old file or
+ *          the complete new one.
+ *
+ * @throws std::runtime_error If the file cannot be written.
+ */
+int CompiledDFA::save(const std::string &path) const
+{
+    DFAFileLayout layout(num_states, num_classes, num_inner_states);
+    std::vector<unsigned char> image(layout.size);
+    std::memcpy(image.data() + layout.byte_class, byte_class, MULTIBYTE + 1);
+    std::memcpy(image.data() + layout.table, table, num_states * num_classes * sizeof(uint16_t));
+    if(num_states > 0){
+        std::memcpy(image.data() + layout.attrs, attrs, num_states * sizeof(int));
+        std::memcpy(image.data() + layout.accel, accel, num_states * sizeof(ScanRule));
+    }
+    if(num_inner_states > 0){
+        std::memcpy(image.data() + layout.inner_states, inner_states, num_inner_states * sizeof(uint16_t));
+    }
+
+    DFAFileHeader header{};
+    std::memcpy(header.magic, DFA_FILE_MAGIC, sizeof(header.magic));
+    header.version = DFA_FILE_VERSION;
+    header.byte_order = DFA_FILE_BYTE_ORDER;
+    header.num_states = num_states;
+    header.num_classes = num_classes;
+    header.num_inner_states = num_inner_states;
+    header.checksum = dfa_file_checksum(image.data() + sizeof(header), image.data() + image.size());
+    header.size = layout.size;
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write((const char *)image.data(), image.size());
+    out.close();
+    if(!out || std::rename(temp.c_str(), path.c_str()) != 0){
+        std::remove(temp.c_str());
+        throw std::runtime_error("Cannot write DFA file " + path);
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a table written by `save` and returns a CompiledDFA that uses it in place.
+ *
+ * @details The mapping lives as long as the returned table or any copy of it. Besides
+ *          the header and checksum, every state index and byte class in the file is
+ *          checked to be in range, so a table that loads can be scanned safely.
+ *
+ * @throws std::runtime_error If the file cannot be opened or mapped.
+ * @throws std::invalid_argument If the file is not a valid DFA file of this version.
+ */
+CompiledDFA CompiledDFA::load(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw std::runtime_error("Cannot open DFA file " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+        addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if(addr == MAP_FAILED){
+        throw std::runtime_error("Cannot map DFA file " + path);
+    }
+    size_t size = st.st_size;
+    std::shared_ptr<const void> mapping(addr, [size](const void *p){
+        munmap((void *)p, size);
+    });
+
+    auto invalid = [&](const std::string &reason){
+        return std::invalid_argument("DFA file " + path + " " + reason);
+    };
+    const unsigned char *base = (const unsigned char *)addr;
+    DFAFileHeader header;
+    if(size < sizeof(header)){
+        throw invalid("is truncated");
+    }
+    std::memcpy(&header, base, sizeof(header));
+    if(std::memcmp(header.magic, DFA_FILE_MAGIC, sizeof(header.magic)) != 0){
+        throw invalid("is not a DFA file");
+    }
+    if(header.version != DFA_FILE_VERSION){
+        throw invalid("has format version " + std::to_string(header.version) + ", expected " + std::to_string(DFA_FILE_VERSION));
+    }
+    if(header.byte_order != DFA_FILE_BYTE_ORDER){
+        throw invalid("was written with a different byte order");
+    }
+    if(header.num_states < 1 || header.num_states > MAX_STATES || header.num_classes < 1 || header.num_classes > 256
+        || header.num_inner_states > header.num_states){
+        throw invalid("has invalid table sizes");
+    }
+    DFAFileLayout layout(header.num_states, header.num_classes, header.num_inner_states);
+    if(header.size != size || layout.size != size){
+        throw invalid("is truncated or has trailing data");
+    }
+    if(header.checksum != dfa_file_checksum(base + sizeof(header), base + size)){
+        throw invalid("is corrupt (checksum mismatch)");
+    }
+
+    CompiledDFA dfa((const uint8_t *)(base + layout.byte_class), header.num_states, header.num_classes,
+        (const uint16_t *)(base + layout.table), (const int *)(base + layout.attrs), (const ScanRule *)(base + layout.accel),
+        (const uint16_t *)(base + layout.inner_states), header.num_inner_states);
+    for(int b = 0; b <= MULTIBYTE; b ++){
+        if(dfa.byte_class[b] >= dfa.num_classes){
+            throw invalid("maps a byte to a missing class");
+        }
+    }
+    for(int k = 0; k < dfa.num_states * dfa.num_classes; k ++){
+        if(dfa.table[k] != NO_TRANSITION && (dfa.table[k] & STATE_MASK) >= dfa.num_states){
+            throw invalid("has a transition to a missing state");
+        }
+    }
+    for(int i = 0; i < dfa.num_states; i ++){
+        if(dfa.accel[i].kind > ScanRule::UNTIL){
+            throw invalid("has an unknown scan rule");
+        }
+    }
+    for(int k = 0; k < dfa.num_inner_states; k ++){
+        if(dfa.inner_states[k] >= dfa.num_states){
+            throw invalid("lists a missing inner state");
+        }
+    }
+    dfa.storage = mapping;
+    return dfa;
+}
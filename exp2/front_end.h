@@ -0,0 +1,28 @@
+// front_end.h
+#ifndef FRONT_END_H_
+#define FRONT_END_H_
+
+// The grammar of the language and the stages before code generation: lexing (in
+// process, see source_lexer.h) and parsing into intermediate code
+
+#include <ostream>
+#include <string_view>
+#include "syntax_parser.h"
+
+class SourceBuffer;
+
+void GenerateTable();
+const LR1Table &GetTable();
+// a parser on the shared table; each thread needs its own
+SyntaxParser MakeParser();
+std::string_view ReadProgram(SourceBuffer &source);
+void GetTokens(std::string_view text, std::vector<Symbol> &tokens, std::ostream *dump = nullptr);
+// lexes and parses a program with `parser`; throws SyntaxError
+ICode ParseProgram(std::string_view text, SyntaxParser &parser, std::ostream *tokens_dump = nullptr);
+// prints a syntax error as Main does: the message on stderr, "Syntax Error" on stdout
+void ReportSyntaxError(const SyntaxError &error);
+// writes the symbol table and quadruples in the text format exp3 reads
+void Output(const ICode &icode, std::ostream &out);
+void OutputBinary(const ICode &icode, int fd);
+
+#endif  // FRONT_END_H_
@@ -0,0 +1,148 @@
+#include "incremental_lexer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+IncrementalLexer::IncrementalLexer(CompiledDFA table)
+    : table(table), text("\n"), status(LexicalAnalyzer::OK), error_code(0) {}
+
+/**
+ * @brief Replaces the whole text and lexes it from scratch.
+ *
+ * @return The status LexicalAnalyzer::analyze would return for the text.
+ */
+int IncrementalLexer::set_text(std::string_view source)
+{
+    edit(0, text.size() - 1, source);
+    return status;
+}
+
+/**
+ * @brief Replaces `removed` bytes at `offset` with `inserted` and updates the tokens.
+ *
+ * @return Which tokens were replaced; get_tokens() holds the new array.
+ *
+ * @details Re-lexing starts at the end of the last token that ends at least 4 bytes
+ *          before `offset`, so its lookahead character is unchanged, and stops when a new token starts
+ *          past the edit at the (shifted) start of an old token. If the scan stops
+ *          on an error first, every old token after the edit is dropped, as a full
+ *          analysis stops there too.
+ *
+ * @throws std::out_of_range If the removed range is not inside the text, or a token
+ *         does not fit in a Token.
+ */
+TokenSplice IncrementalLexer::edit(size_t offset, size_t removed, std::string_view inserted)
+{
+    size_t size = text.size() - 1;
+    if(offset > size || removed > size - offset){
+        throw std::out_of_range("IncrementalLexer edit outside of the text");
+    }
+    if(size - removed + inserted.size() > UINT32_MAX){
+        throw std::out_of_range("IncrementalLexer text does not fit in 32-bit token offsets");
+    }
+    text.replace(offset, removed, inserted);
+    size_t edit_end = offset + inserted.size();
+    long long delta = (long long)inserted.size() - (long long)removed;
+
+    // keep the tokens whose lookahead character, up to 4 bytes of UTF-8, is before the edit
+    TokenSplice splice;
+    splice.first = std::partition_point(tokens.begin(), tokens.end(), [&](const Token &token){
+        return token.offset + token.length + 3 < offset;
+    }) - tokens.begin();
+    size_t restart = splice.first == 0 ? 0 : tokens[splice.first - 1].offset + tokens[splice.first - 1].length;
+
+    // re-lex until a new token starts where an old one did
+    std::vector<Token> fresh;
+    size_t old_next = splice.first;
+    bool synced = false;
+    ScanCursor cursor;
+    cursor.pos = cursor.token_start = restart;
+    cursor = table.scan((const unsigned char *)text.data(), text.size(), cursor, [&](size_t first, size_t last, int attr){
+        if(first >= edit_end){
+            size_t old_first = first - delta;
+            while(old_next < tokens.size() && tokens[old_next].offset < old_first){
+                old_next ++;
+            }
+            if(old_next < tokens.size() && tokens[old_next].offset == old_first){
+                synced = true;
+                return false;
+            }
+        }
+        if(attr == LexicalAnalyzer::IGNORE){
+            return true;
+        }
+        if(attr < 0 || attr > Token::MAX_KIND || last - first > Token::MAX_LENGTH){
+            throw std::out_of_range("Token kind or length out of range");
+        }
+        if(attr >= spellings.size()){
+            spellings.resize(attr + 1);
+        }
+        Token token;
+        token.offset = first;
+        token.length = last - first;
+        token.kind = attr;
+        token.id = spellings[attr].intern(std::string_view(text).substr(first, last - first));
+        fresh.push_back(token);
+        return true;
+    });
+
+    // splice the new tokens in and shift the kept tail
+    size_t tail = synced ? old_next : tokens.size();
+    splice.removed = tail - splice.first;
+    splice.inserted = fresh.size();
+    if(splice.inserted > splice.removed){
+        tokens.insert(tokens.begin() + tail, splice.inserted - splice.removed, Token());
+    }else{
+        tokens.erase(tokens.begin() + splice.first + splice.inserted, tokens.begin() + tail);
+    }
+    std::copy(fresh.begin(), fresh.end(), tokens.begin() + splice.first);
+    if(delta != 0){
+        for(size_t k = splice.first + splice.inserted; k < tokens.size(); k ++){
+            tokens[k].offset += delta;
+        }
+    }
+
+    // after a resync the rest of the text lexes as before, and so keeps its status
+    if(synced){
+        return splice;
+    }
+    if(cursor.status == ScanCursor::UNRECOGNIZED_SYMBOL){
+        status = LexicalAnalyzer::UNRECOGNIZED_SYMBOL;
+    }else if(cursor.status == ScanCursor::FAILED){
+        status = LexicalAnalyzer::UNKNOWN_ERROR;
+        error_code = cursor.error;
+    }else if(cursor.pos < text.size()){
+        status = LexicalAnalyzer::UNRECOGNIZED_SYMBOL;
+    }else{
+        status = cursor.token_start == cursor.pos ? LexicalAnalyzer::OK : LexicalAnalyzer::UNRECOGNIZED_IDENTIFIER;
+    }
+    return splice;
+}
+
+std::string_view IncrementalLexer::get_text() const
+{
+    return std::string_view(text).substr(0, text.size() - 1);
+}
+
+const std::vector<Token> &IncrementalLexer::get_tokens() const
+{
+    return this->tokens;
+}
+
+std::string_view IncrementalLexer::lexeme(const Token &token) const
+{
+    return spellings[token.kind].get_name(token.id);
+}
+
+/**
+ * @brief Returns the status of the current text, one of the LexicalAnalyzer codes.
+ */
+int IncrementalLexer::get_status() const
+{
+    return this->status;
+}
+
+int IncrementalLexer::get_error() const
+{
+    return this->error_code;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lexical_analysis.h"
+
+/**
+ * @brief The tokens that an edit replaced: `removed` tokens starting at index
+ *        `first` of the old token array became `inserted` tokens starting at the
+ *        same index of the new one. Tokens after them were kept, shifted by the
+ *        length difference of the edit.
+ */
+struct TokenSplice
+{
+    size_t first = 0, removed = 0, inserted = 0;
+};
+
+/**
+ * @brief Keeps the tokens of a source text up to date while the text is edited.
+ *
+ * Every token of the lexer starts in the start state with nothing pending, so the
+ * end of any token is a point where the scan can be restarted without any saved
+ * DFA state. An edit is re-lexed from the end of the last token that is not
+ * touched by it (its lookahead byte included) and stops as soon as a new token
+ * starts, past the edit, exactly where an old token started: from there on both
+ * scans read the same bytes from the same state, so the old tokens are kept.
+ * Lexing work is proportional to the size of the edit, plus the tokens it spans;
+ * updating the text, the token array and the offsets after the edit is a linear
+ * memory move.
+ *
+ * The text is stored with a trailing '\n', as LexicalAnalyzer::analyze(SourceBuffer &)
+ * appends one, so a token at the very end is still terminated. Token offsets,
+ * statuses and error codes are the same as those of LexicalAnalyzer on the whole text.
+ */
+class IncrementalLexer
+{
+    private:
+        CompiledDFA table;
+        std::string text;
+        std::vector<Token> tokens;
+        std::vector<InternTable> spellings;
+        int status, error_code;
+
+    public:
+        IncrementalLexer(CompiledDFA);
+        int set_text(std::string_view);
+        TokenSplice edit(size_t offset, size_t removed, std::string_view inserted);
+        std::string_view get_text() const;
+        const std::vector<Token> &get_tokens() const;
+        std::string_view lexeme(const Token &) const;
+        int get_status() const;
+        int get_error() const;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * @brief Finds a word of a fixed set through a minimal perfect hash: the table has
+ *        exactly one slot per word and no two words share a slot, so a lookup is one
+ *        hash of the string and one comparison with the word in its slot.
+ *
+ * The slot of `s` is `reduce(mix(h + seeds[reduce(h)]))`, where h is the FNV-1a hash of
+ * `s` and `reduce` maps a hash to [0, size) by a multiplication instead of a division
+ * (hash and displace): words are grouped into buckets by h, and every bucket has its
+ * own seed that sends all of its words to free slots. Strings whose length is not
+ * that of any word are rejected before hashing. The tables are built by KeywordHash,
+ * normally at compile time; this only points to them.
+ */
+struct KeywordSet
+{
+    const std::string_view *words = nullptr;    // the word in each slot
+    const int *kinds = nullptr;                 // its token kind
+    const uint32_t *seeds = nullptr;            // one per bucket
+    uint32_t size = 0;
+    size_t min_length = 1, max_length = 0;
+
+    static constexpr uint32_t hash(std::string_view s)
+    {
+        uint32_t h = 2166136261u;
+        for(char ch : s){
+            h = (h ^ (unsigned char)ch) * 16777619u;
+        }
+        return h;
+    }
+
+    static constexpr uint32_t mix(uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static constexpr uint32_t reduce(uint32_t h, uint32_t size)
+    {
+        return (uint64_t)h * size >> 32;
+    }
+
+    /**
+     * @brief Returns the kind of `s` if it is one of the words, or -1.
+     */
+    constexpr int find(std::string_view s) const
+    {
+        if(s.size() < min_length || s.size() > max_length){
+            return -1;
+        }
+        uint32_t h = hash(s);
+        uint32_t slot = reduce(mix(h + seeds[reduce(h, size)]), size);
+        return words[slot] == s ? kinds[slot] : -1;
+    }
+};
+
+/**
+ * @brief The tables of a KeywordSet for N words, built as a constant expression.
+ *        Word `i` of the array gets kind `i`, as the keyword token kinds do.
+ *
+ * @details Buckets are placed from the largest down, each with the first seed whose
+ *          slots are all free, so the search rarely tries more than a few seeds.
+ *
+ * @throws std::invalid_argument If no seed places a bucket, which only happens when
+ *         the same word is given twice. At compile time this is a compile error.
+ */
+template<size_t N>
+struct KeywordHash
+{
+    static_assert(N > 0, "KeywordHash needs at least one word");
+    static constexpr uint32_t MAX_SEED = 1 << 16;
+
+    std::string_view words[N]{};
+    int kinds[N]{};
+    uint32_t seeds[N]{};
+    size_t min_length = SIZE_MAX, max_length = 0;
+
+    constexpr KeywordHash(const std::array<std::string_view, N> &keywords)
+    {
+        uint32_t hashes[N]{}, count[N]{};
+        uint32_t bucket[N]{};
+        for(size_t i = 0; i < N; i ++){
+            hashes[i] = KeywordSet::hash(keywords[i]);
+            bucket[i] = KeywordSet::reduce(hashes[i], N);
+            count[bucket[i]] ++;
+            min_length = std::min(min_length, keywords[i].size());
+            max_length = std::max(max_length, keywords[i].size());
+        }
+        bool used[N]{};
+        for(uint32_t bucket_size = N; bucket_size > 0; bucket_size --){
+            for(uint32_t b = 0; b < N; b ++){
+                if(count[b] != bucket_size){
+                    continue;
+                }
+                for(uint32_t seed = 0; ; seed ++){
+                    if(seed == MAX_SEED){
+                        throw std::invalid_argument("KeywordHash found no free slots, is a word repeated?");
+                    }
+                    uint32_t slots[N]{};
+                    uint32_t placed = 0;
+                    for(size_t i = 0; i < N; i ++){
+                        if(bucket[i] != b){
+                            continue;
+                        }
+                        uint32_t slot = KeywordSet::reduce(KeywordSet::mix(hashes[i] + seed), N);
+                        bool taken = used[slot];
+                        for(uint32_t k = 0; k < placed; k ++){
+                            taken = taken || slots[k] == slot;
+                        }
+                        if(taken){
+                            break;
+                        }
+                        slots[placed ++] = slot;
+                    }
+                    if(placed != bucket_size){
+                        continue;
+                    }
+                    placed = 0;
+                    for(size_t i = 0; i < N; i ++){
+                        if(bucket[i] == b){
+                            uint32_t slot = slots[placed ++];
+                            used[slot] = true;
+                            words[slot] = keywords[i];
+                            kinds[slot] = i;
+                        }
+                    }
+                    seeds[b] = seed;
+                    break;
+                }
+            }
+        }
+    }
+
+    constexpr KeywordSet get() const
+    {
+        return KeywordSet{words, kinds, seeds, N, min_length, max_length};
+    }
+};
@@ -1,30 +1,144 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sstream>
 #include "lexical_analysis.h"
 #include "my_dfa.h"
+#include "static_dfa.h"
+#include "source_buffer.h"
+#include "batch_lexer.h"
+#include "line_index.h"
 
-int main(){
+// writes the tokens of an analyzed file, or its errors; errors are placed by line and
+// column when there are `lines` of the input, and by byte offset otherwise
+static int print_result(std::ostream &out, LexicalAnalyzer &b, int ret, const LineIndex *lines)
+{
+    if(!b.get_diagnostics().empty()){
+        for(auto &diagnostic : b.get_diagnostics()){
+            int code = diagnostic.status == LexicalAnalyzer::UNKNOWN_ERROR ? diagnostic.error : 4;
+            if(lines == nullptr){
+                out << diagnostic.offset;
+            }else{
+                auto [line, column] = lines->locate(diagnostic.offset);
+                out << line << ":" << column;
+            }
+            out << ": " << output_errs[code] << "\n";
+        }
+    }else if(ret == LexicalAnalyzer::UNKNOWN_ERROR){
+        auto res = b.get_error();
+        out << output_errs[res] << "\n";
+    }else if(ret == LexicalAnalyzer::UNRECOGNIZED_SYMBOL){
+        out << output_errs[4] << "\n";
+    }else{
+        for(auto &token : b.get_result()){
+            out << b.lexeme(token) << " " << output_types[token.kind] << "\n";
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]){
     std::ios::sync_with_stdio(false);
     std::cin.tie(0);
 
-    MakeDFA a;
-    DFA dfa = a.make_dfa();
+    // the tables and the code that scans them are generated at build time, see static_dfa.h
+    CompiledDFA dfa = get_static_dfa();
+    dfa.set_direct_scanner(lexer_direct_scanner);
     LexicalAnalyzer b(dfa);
-    std::string s, t;
-    while(std::getline(std::cin, t)){
-        s += t + "\n";
+    b.set_threads(0);
+
+    // --dfa-stats reports the DFA size before and after minimization on stderr,
+    // --all-errors reports every lexical error (at line:column)
+    // instead of stopping at the first one,
+    // --keyword-hash lexes keywords as identifiers and tells them apart by a perfect hash,
+    // --dfa FILE lexes with a table saved by --save-dfa FILE (see CompiledDFA::save),
+    // --batch lexes every file named after the options (or, if none, on stdin, one per
+    // line) on a thread pool, printing each result after a "==> FILE <==" line
+    bool batch = false;
+    int arg = 1;
+    for(; arg < argc && std::string(argv[arg]).rfind("--", 0) == 0; arg ++){
+        std::string option = argv[arg];
+        if(option == "--dfa-stats"){
+            MakeDFA a;
+            a.make_dfa();
+            auto [built, minimized] = a.get_state_counts();
+            std::cerr << "DFA states: " << built << " -> " << minimized << "\n";
+        }else if(option == "--all-errors"){
+            std::string sync;
+            for(auto ch : empty_characters){
+                sync += ch;
+            }
+            for(auto ch : operators_characters){
+                sync += ch;
+            }
+            b.set_recovery(sync);
+        }else if(option == "--keyword-hash"){
+            CompiledDFA identifier_dfa = get_static_identifier_dfa();
+            identifier_dfa.set_direct_scanner(identifier_direct_scanner);
+            b.set_dfa(identifier_dfa);
+            b.set_keywords(get_static_keywords(), identifier_kind);
+        }else if(option == "--batch"){
+            batch = true;
+        }else if((option == "--dfa" || option == "--save-dfa") && arg + 1 < argc){
+            std::string path = argv[++ arg];
+            try{
+                if(option == "--save-dfa"){
+                    b.get_dfa().save(path);
+                    continue;
+                }
+                CompiledDFA loaded = CompiledDFA::load(path);
+                if(loaded.get_fingerprint() == lexer_direct_scanner.fingerprint){
+                    loaded.set_direct_scanner(lexer_direct_scanner);
+                }
+                b.set_dfa(loaded);
+            }catch(std::exception &e){
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+        }else{
+            std::cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
     }
 
-    int ret = b.analyze(s);
-    
-    if(ret == LexicalAnalyzer::UNKNOWN_ERROR){
-        auto res = b.get_error();
-        std::cout << output_errs[res] << "\n";
-    }else if(ret == LexicalAnalyzer::UNRECOGNIZED_SYMBOL){
-        std::cout << output_errs[4] << "\n";
-    }else{
-        auto res = b.get_result();
-        for(auto [str, type]: res){
-            std::cout << str << " " << output_types[type] << "\n";
+    if(batch){
+        std::vector<std::string> paths(argv + arg, argv + argc);
+        for(std::string line; arg == argc && std::getline(std::cin, line); ){
+            if(!line.empty()){
+                paths.push_back(line);
+            }
         }
+        BatchLexer lexer(b);
+        int failed = lexer.run(paths, [](const std::string &path, std::string_view text, LexicalAnalyzer &analyzer, int ret){
+            std::ostringstream out;
+            out << "==> " << path << " <==\n";
+            LineIndex lines(text);
+            print_result(out, analyzer, ret, text.empty() ? nullptr : &lines);
+            return out.str();
+        }, std::cout);
+        return failed ? 1 : 0;
+    }
+
+    // lex the file given on the command line, or stdin
+    int fd = STDIN_FILENO;
+    if(arg < argc && (fd = open(argv[arg], O_RDONLY)) < 0){
+        std::cerr << "Cannot open " << argv[arg] << "\n";
+        return 1;
+    }
+    try{
+        SourceBuffer source(fd);
+        // a mapped file is indexed only if there are errors to place, a pipe while it is read
+        LineIndex streamed_lines;
+        if(!source.is_mapped()){
+            source.set_line_index(&streamed_lines);
+        }
+
+        int ret = b.analyze(source);
+        LineIndex mapped_lines(source.contents());
+        print_result(std::cout, b, ret, source.is_mapped() ? &mapped_lines : &streamed_lines);
+    }catch(const std::exception &e){
+        // a source that cannot be read, such as a directory
+        std::cerr << (arg < argc ? argv[arg] : "stdin") << ": " << e.what() << "\n";
+        return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
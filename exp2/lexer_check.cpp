@@ -0,0 +1,410 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include "incremental_lexer.h"
+#include "lexical_analysis.h"
+#include "static_dfa.h"
+
+/**
+ * @brief Consistency checks of the lexer, run by `make check`.
+ *
+ * Usage: lexer_check [--seed N]
+ *
+ * Each check lexes random inputs in two ways that have to give the same result,
+ * one of them the plain sequential scan of LexicalAnalyzer. The inputs are made of
+ * pieces of the token language; "noisy" inputs also glue pieces together and mix
+ * in malformed ones, so that every kind of lexical error comes up. A check that
+ * fails prints the first differences; the exit status is 1 if any check failed.
+ */
+
+// pieces of the token language, separated by whitespace in clean inputs
+static const char *clean_pieces[] = {
+    "int", "double", "if", "then", "while", "do", "scanf", "printf", "x", "abc1", "whilex", "Int2",
+    "0", "12", "3.25", "0.5", "=", "==", ">", ">=", "<", "<=", "||", "&&", "!", "!=", "+", "-", "*", "/",
+    ",", "(", ")", "{", "}", ";", "/* a * b / c \xc3\xa9 */", "// line \xe4\xb8\xad\n"
+};
+// pieces that are lexical errors on their own
+static const char *error_pieces[] = {
+    "@", "1.2.3", "01", ".5", "3.", "|", "&", "12ab", "\xc3\xa9", "\xff", "\xe4\xb8", "_", "/* open"
+};
+static const char *whitespace_pieces[] = {" ", " ", " ", "\n", "\t", "\r\n"};
+
+template<class T, size_t N>
+static const T &pick(std::mt19937 &random, const T (&items)[N])
+{
+    return items[random() % N];
+}
+
+/**
+ * @brief Returns a random input of at least `size` bytes. A clean input lexes without
+ *        errors; in a noisy one about one piece in `error_rate` is malformed and
+ *        pieces are often glued together.
+ */
+static std::string random_input(std::mt19937 &random, size_t size, bool noisy, int error_rate = 50)
+{
+    std::string input;
+    while(input.size() < size){
+        if(noisy && random() % error_rate == 0){
+            input += pick(random, error_pieces);
+        }else{
+            input += pick(random, clean_pieces);
+        }
+        if(!noisy || random() % 4 != 0){
+            input += pick(random, whitespace_pieces);
+        }
+    }
+    return input;
+}
+
+/**
+ * @brief Describes a result of the lexer, one line per item: the status and error
+ *        code, then every token and every diagnostic.
+ */
+static std::string describe(LexicalAnalyzer &analyzer, int ret)
+{
+    std::string text = "status " + std::to_string(ret);
+    if(ret == LexicalAnalyzer::UNKNOWN_ERROR){
+        text += " error " + std::to_string(analyzer.get_error());
+    }
+    text += "\n";
+    for(auto &token : analyzer.get_result()){
+        text += std::to_string(token.offset) + " " + std::to_string(token.length) + " " + std::to_string(token.kind) + " "
+            + std::to_string(token.id) + " " + std::string(analyzer.lexeme(token)) + "\n";
+    }
+    for(auto &diagnostic : analyzer.get_diagnostics()){
+        text += "diagnostic " + std::to_string(diagnostic.offset) + " " + std::to_string(diagnostic.length) + " "
+            + std::to_string(diagnostic.status) + " " + std::to_string(diagnostic.error) + "\n";
+    }
+    return text;
+}
+
+/**
+ * @brief Compares two results of the lexer item by item, as `describe` would list
+ *        them, without building the descriptions of large inputs.
+ */
+static bool same_result(LexicalAnalyzer &a, int a_ret, LexicalAnalyzer &b, int b_ret)
+{
+    if(a_ret != b_ret || (a_ret == LexicalAnalyzer::UNKNOWN_ERROR && a.get_error() != b.get_error())){
+        return false;
+    }
+    auto &a_tokens = a.get_result(), &b_tokens = b.get_result();
+    if(a_tokens.size() != b_tokens.size()){
+        return false;
+    }
+    for(size_t k = 0; k < a_tokens.size(); k ++){
+        const Token &x = a_tokens[k], &y = b_tokens[k];
+        if(x.offset != y.offset || x.length != y.length || x.kind != y.kind || x.id != y.id || a.lexeme(x) != b.lexeme(y)){
+            return false;
+        }
+    }
+    auto &a_diagnostics = a.get_diagnostics(), &b_diagnostics = b.get_diagnostics();
+    if(a_diagnostics.size() != b_diagnostics.size()){
+        return false;
+    }
+    for(size_t k = 0; k < a_diagnostics.size(); k ++){
+        const Diagnostic &x = a_diagnostics[k], &y = b_diagnostics[k];
+        if(x.offset != y.offset || x.length != y.length || x.status != y.status || x.error != y.error){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the first line where two descriptions differ.
+ */
+static int report(const char *check, const std::string &what, const std::string &expected, const std::string &actual)
+{
+    size_t line = 1, pos = 0;
+    while(pos < expected.size() && pos < actual.size() && expected[pos] == actual[pos]){
+        line += expected[pos ++] == '\n';
+    }
+    size_t start = expected.rfind('\n', pos == 0 ? 0 : pos - 1);
+    start = start == std::string::npos ? 0 : start + 1;
+    printf("%s: %s differs at line %zu\n  expected: %s\n  actual:   %s\n", check, what.c_str(), line,
+        expected.substr(start, expected.find('\n', start) - start).c_str(), actual.substr(start, actual.find('\n', start) - start).c_str());
+    return 0;
+}
+
+// the sync bytes of `Main --all-errors`
+static std::string sync_bytes()
+{
+    std::string sync;
+    for(auto ch : empty_characters){
+        sync += ch;
+    }
+    for(auto ch : operators_characters){
+        sync += ch;
+    }
+    return sync;
+}
+
+/**
+ * @brief Parallel against sequential analysis, with and without error recovery, on
+ *        inputs large enough to be cut into chunks.
+ */
+static int check_parallel(std::mt19937 &random)
+{
+    int failures = 0;
+    for(int k = 0; k < 6; k ++){
+        bool noisy = k % 2;
+        std::string input = random_input(random, 2 * LexicalAnalyzer::PARALLEL_CHUNK + random() % LexicalAnalyzer::PARALLEL_CHUNK,
+            noisy, 2000);
+        for(bool recovery : {false, true}){
+            LexicalAnalyzer sequential(get_static_dfa());
+            if(recovery){
+                sequential.set_recovery(sync_bytes());
+            }
+            int expected = sequential.analyze(input);
+            for(unsigned threads : {2, 3, 8}){
+                LexicalAnalyzer parallel(get_static_dfa());
+                parallel.set_threads(threads);
+                if(recovery){
+                    parallel.set_recovery(sync_bytes());
+                }
+                int actual = parallel.analyze(input);
+                if(!same_result(sequential, expected, parallel, actual) && failures ++ < 3){
+                    report("parallel", "input " + std::to_string(k) + (noisy ? " (noisy)" : "") + (recovery ? " with recovery" : "")
+                        + " on " + std::to_string(threads) + " threads", describe(sequential, expected), describe(parallel, actual));
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// the status and the tokens of a result, without spelling ids, which depend on the
+// order in which spellings were first seen
+template<class Lexeme>
+static std::string describe_tokens(int status, int error, const std::vector<Token> &tokens, Lexeme &&lexeme)
+{
+    std::string text = "status " + std::to_string(status);
+    if(status == LexicalAnalyzer::UNKNOWN_ERROR){
+        text += " error " + std::to_string(error);
+    }
+    text += "\n";
+    for(auto &token : tokens){
+        text += std::to_string(token.offset) + " " + std::to_string(token.length) + " " + std::to_string(token.kind) + " "
+            + std::string(lexeme(token)) + "\n";
+    }
+    return text;
+}
+
+/**
+ * @brief IncrementalLexer against a full analysis of the edited text, after every one
+ *        of a series of random edits: insertions, deletions and replacements.
+ */
+static int check_incremental(std::mt19937 &random)
+{
+    int failures = 0;
+    for(int k = 0; k < 40; k ++){
+        IncrementalLexer incremental(get_static_dfa());
+        incremental.set_text(random_input(random, random() % 400, k % 4 != 0));
+        for(int step = 0; step < 100; step ++){
+            size_t size = incremental.get_text().size() - 1;
+            size_t offset = random() % (size + 1);
+            size_t removed = random() % 3 == 0 ? 0 : random() % (std::min<size_t>(size - offset, 30) + 1);
+            std::string inserted = random() % 3 == 0 ? "" : random_input(random, random() % 12, true, 8);
+            incremental.edit(offset, removed, inserted);
+
+            // the incremental lexer adds a newline at the end, as analyze(SourceBuffer &) does
+            std::string text = std::string(incremental.get_text()) + "\n";
+            LexicalAnalyzer full(get_static_dfa());
+            int status = full.analyze(text);
+            std::string expected = describe_tokens(status, full.get_error(), full.get_result(), [&](const Token &token){
+                return full.lexeme(token);
+            });
+            std::string actual = describe_tokens(incremental.get_status(), incremental.get_error(), incremental.get_tokens(),
+                [&](const Token &token){
+                    return incremental.lexeme(token);
+                });
+            if(actual != expected){
+                if(failures ++ < 3){
+                    report("incremental", "text " + std::to_string(k) + " after edit " + std::to_string(step) + " (" + std::to_string(offset)
+                        + ", " + std::to_string(removed) + ", " + std::to_string(inserted.size()) + " bytes)", expected, actual);
+                }
+                break;
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ * @brief KeywordSet lookups against the keyword states of the lexer DFA.
+ *
+ * @details Every keyword, and words one edit away from one, has to get the same kind
+ *          from get_static_keywords() as a lone token of that word gets from the DFA
+ *          with keyword states (an identifier if it is not a keyword). Then random
+ *          inputs are lexed with keyword states and with the identifier DFA and the
+ *          keyword set, each time both with the table loop and with the generated
+ *          scanners.
+ */
+static int check_keywords(std::mt19937 &random)
+{
+    int failures = 0;
+    KeywordSet keyword_set = get_static_keywords();
+    std::vector<std::string> words;
+    for(auto keyword : keywords){
+        std::string word(keyword);
+        words.push_back(word);
+        words.push_back(word + "x");
+        words.push_back(word + "1");
+        words.push_back(word.substr(0, word.size() - 1));
+        words.push_back(word.substr(1));
+        words.push_back(std::string(1, word[0] - 'a' + 'A') + word.substr(1));
+        words.push_back(word + word);
+    }
+    for(int k = 0; k < 200; k ++){
+        std::string word(1, alphabet[random() % alphabet.size()][0]);
+        for(int n = random() % 8; n > 0; n --){
+            word += random() % 4 == 0 ? numbers[random() % numbers.size()][0] : alphabet[random() % alphabet.size()][0];
+        }
+        words.push_back(word);
+    }
+    for(auto &word : words){
+        if(word.empty()){
+            continue;
+        }
+        LexicalAnalyzer analyzer(get_static_dfa());
+        int ret = analyzer.analyze(word + "\n");
+        int found = keyword_set.find(word);
+        int expected = found >= 0 ? found : identifier_kind;
+        if(ret != LexicalAnalyzer::OK || analyzer.get_result().size() != 1 || analyzer.get_result()[0].kind != expected){
+            if(failures ++ < 3){
+                printf("keywords: \"%s\" is found as %d, but the DFA lexes it as %s\n", word.c_str(), found,
+                    describe(analyzer, ret).c_str());
+            }
+        }
+    }
+
+    CompiledDFA lexer_dfa = get_static_dfa(), identifier_dfa = get_static_identifier_dfa();
+    CompiledDFA lexer_direct = lexer_dfa, identifier_direct = identifier_dfa;
+    lexer_direct.set_direct_scanner(lexer_direct_scanner);
+    identifier_direct.set_direct_scanner(identifier_direct_scanner);
+    for(int k = 0; k < 100; k ++){
+        std::string input = random_input(random, random() % 2000, k % 2);
+        LexicalAnalyzer expected(lexer_dfa);
+        int expected_ret = expected.analyze(input);
+        for(int variant = 0; variant < 3; variant ++){
+            LexicalAnalyzer actual(variant == 0 ? lexer_direct : variant == 1 ? identifier_dfa : identifier_direct);
+            if(variant > 0){
+                actual.set_keywords(keyword_set, identifier_kind);
+            }
+            int actual_ret = actual.analyze(input);
+            if(!same_result(expected, expected_ret, actual, actual_ret) && failures ++ < 3){
+                const char *names[] = {"keyword states, generated scanner", "keyword set", "keyword set, generated scanner"};
+                report("keywords", "input " + std::to_string(k) + " with " + names[variant], describe(expected, expected_ret),
+                    describe(actual, actual_ret));
+            }
+        }
+    }
+    return failures;
+}
+
+// whether CompiledDFA::load refuses the file `path` with `contents`
+static bool load_fails(const std::string &path, const std::string &contents)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+    try{
+        CompiledDFA::load(path);
+    }catch(const std::exception &){
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief CompiledDFA::save and load: a saved table loads back with the same tables and
+ *        lexes the same, and a truncated file, or one with any single byte changed,
+ *        is refused.
+ */
+static int check_dfa_file(std::mt19937 &random)
+{
+    int failures = 0;
+    char path[] = "/tmp/lexer_check_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0){
+        printf("dfa-file: cannot create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    for(CompiledDFA dfa : {get_static_dfa(), get_static_identifier_dfa()}){
+        dfa.save(path);
+        CompiledDFA loaded = CompiledDFA::load(path);
+        if(loaded.get_fingerprint() != dfa.get_fingerprint() || loaded.get_num_states() != dfa.get_num_states()
+            || loaded.get_num_classes() != dfa.get_num_classes() || loaded.get_num_inner_states() != dfa.get_num_inner_states()){
+            failures ++;
+            printf("dfa-file: the loaded table differs from the saved one\n");
+        }
+        for(int k = 0; k < 20; k ++){
+            std::string input = random_input(random, random() % 2000, k % 2);
+            LexicalAnalyzer expected(dfa), actual(loaded);
+            int expected_ret = expected.analyze(input), actual_ret = actual.analyze(input);
+            if(!same_result(expected, expected_ret, actual, actual_ret) && failures ++ < 3){
+                report("dfa-file", "input " + std::to_string(k) + " with the loaded table", describe(expected, expected_ret),
+                    describe(actual, actual_ret));
+            }
+        }
+
+        std::ifstream in(path, std::ios::binary);
+        std::string image((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        // cut inside the 40-byte header, right after it, and inside the arrays
+        for(size_t size : {(size_t)0, (size_t)1, (size_t)39, (size_t)40, image.size() / 2, image.size() - 1}){
+            if(!load_fails(path, image.substr(0, size)) && failures ++ < 3){
+                printf("dfa-file: a file truncated to %zu of %zu bytes loads\n", size, image.size());
+            }
+        }
+        if(!load_fails(path, image + '\0') && failures ++ < 3){
+            printf("dfa-file: a file with trailing data loads\n");
+        }
+        for(size_t pos = 0; pos < image.size(); pos ++){
+            std::string corrupt = image;
+            corrupt[pos] ^= 1 << random() % 8;
+            if(!load_fails(path, corrupt) && failures ++ < 3){
+                printf("dfa-file: a file with byte %zu of %zu changed loads\n", pos, image.size());
+            }
+        }
+    }
+    unlink(path);
+    return failures;
+}
+
+int main(int argc, char *argv[]){
+    unsigned seed = 1;
+    if(argc == 3 && std::string(argv[1]) == "--seed"){
+        seed = std::strtoul(argv[2], nullptr, 10);
+    }else if(argc != 1){
+        fprintf(stderr, "Usage: lexer_check [--seed N]\n");
+        return 2;
+    }
+
+    struct Check
+    {
+        const char *name;
+        int (*run)(std::mt19937 &);
+    };
+    const Check checks[] = {
+        {"parallel", check_parallel},
+        {"incremental", check_incremental},
+        {"keywords", check_keywords},
+        {"dfa-file", check_dfa_file},
+    };
+    int failed = 0;
+    for(auto &check : checks){
+        std::mt19937 random(seed);
+        int failures = check.run(random);
+        printf("%-12s %s", check.name, failures ? "FAILED" : "ok");
+        if(failures){
+            printf(" (%d, seed %u)", failures, seed);
+        }
+        printf("\n");
+        failed += failures > 0;
+    }
+    return failed ? 1 : 0;
+}
@@ -6,6 +6,12 @@
 #include <iostream>
 #include <array>
 #include <string_view>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include "simd_scan.h"
+#include "keyword_hash.h"
 
 class State
 {
@@ -22,48 +28,402 @@ class State
         bool operator<(const State &other) const;
 };
 
-class Symbol
+class InputSymbol
 {
     private:
         std::string value;
     
     public:
-        Symbol(std::string value = std::string());
-        Symbol(char);
+        // the value of the symbol that stands for any multibyte UTF-8 character
+        static constexpr std::string_view MULTIBYTE = "<utf-8>";
+
+        InputSymbol(std::string value = std::string());
+        InputSymbol(char);
         std::string get_value() const;
-        bool operator==(const Symbol &other) const;
-        bool operator<(const Symbol &other) const;
+        bool operator==(const InputSymbol &other) const;
+        bool operator<(const InputSymbol &other) const;
 };
 
+class CompiledDFA;
+class SourceBuffer;
+
+/**
+ * @brief A DFA over multi-character symbols, as built by MakeDFA.
+ *
+ * Transitions are one contiguous array of state indexes, `num_states * num_symbols`
+ * entries indexed by `state * num_symbols + symbol`; the State objects, which carry
+ * the type and attribute, are kept in a separate array and only looked up by index.
+ *
+ * A DFA does not change once built and keeps no position of its own: a walk over it
+ * holds its current state index itself and steps with `next_state`, so any number
+ * of threads can read the same DFA.
+ */
 class DFA
 {
     private:
-        std::map<State, int> states;
-        std::map<Symbol, int> symbols;
-        std::vector<std::vector<State>> transition_function;
-        State current_state;
-        
+        std::vector<State> state_list;
+        std::vector<InputSymbol> symbol_list;
+        std::map<InputSymbol, int> symbols;
+        std::vector<uint16_t> transitions;
+
     public:
-        DFA(std::vector<State>, std::vector<Symbol>, std::vector<std::vector<State>>);
-        int reset();
-        int go_next_state(Symbol);
-        State get_current_state();
+        static constexpr int MAX_STATES = UINT16_MAX;
+
+        DFA(std::vector<State>, std::vector<InputSymbol>, std::vector<std::vector<State>>);
+        DFA(std::vector<State>, std::vector<InputSymbol>, std::vector<uint16_t>);
+        int next_state(int state, const InputSymbol &) const;
+        const State &get_state(int state) const;
+        int get_num_states() const;
+        int get_num_symbols() const;
+        uint16_t next(int state, int symbol) const
+        {
+            return transitions[state * symbol_list.size() + symbol];
+        }
+        DFA minimize() const;
+        CompiledDFA compile() const;
+};
+
+/**
+ * @brief Position of a scan over the input: where it is, which DFA state it is in,
+ *        where the token in progress started, and why it stopped if it did not
+ *        reach the end.
+ */
+struct ScanCursor
+{
+    enum { RUNNING, UNRECOGNIZED_SYMBOL, FAILED };
+    static constexpr size_t UNKNOWN = SIZE_MAX;     // token started before the scanned range
+
+    uint16_t state = 0;
+    int status = RUNNING;
+    int error = 0;                  // attribute of the FAIL state
+    size_t pos = 0;                 // next byte to read, or the offending byte
+    size_t token_start = 0;
+};
+
+/**
+ * @brief A scanner generated from a CompiledDFA by gen_scanner, with one block of code
+ *        per state instead of table lookups.
+ *
+ * `scan` behaves exactly like CompiledDFA::scan on the table it was generated from;
+ * tokens are reported through `emit(context, first, last, attr)`. `num_states`,
+ * `num_classes` and `fingerprint` identify that table, so a scanner generated from
+ * a different DFA is refused.
+ */
+struct DirectScanner
+{
+    using EmitFunction = bool (*)(void *context, size_t first, size_t last, int attr);
+    using ScanFunction = ScanCursor (*)(const unsigned char *data, size_t end, ScanCursor cursor, EmitFunction emit, void *context);
+
+    ScanFunction scan;
+    int num_states, num_classes;
+    uint32_t fingerprint;
+};
+
+/**
+ * @brief Flat, byte-indexed form of a DFA used by the lexer hot loop.
+ *
+ * Every input byte is mapped to a symbol class through a 256-entry table, and
+ * `next(state, byte)` is a single load from a dense `uint16_t` array of
+ * `num_states * num_classes` entries. Each entry holds the target state index
+ * with the type of the target packed into its high bits, so the analyzer can
+ * test for token end or failure without touching any other array.
+ *
+ * Bytes from 0x80 up always map to class 0, so ASCII input never leaves that one
+ * lookup. Only when it comes up empty on a byte with the high bit set is the
+ * UTF-8 character starting there decoded, and, if it is well-formed, it steps as
+ * one symbol through the class in the extra slot `byte_class[MULTIBYTE]` (the
+ * class of the InputSymbol::MULTIBYTE symbol of the DFA).
+ *
+ * A token ends on the byte after it. The entry for that byte is flagged ACCEPT and
+ * already holds the transition of the start state on the same byte, so the token
+ * is emitted with the attribute of the current state and the byte starts the next
+ * token in the same step: every byte is looked up exactly once, and the OK states
+ * of the DFA, which only marked the end of a token, are not part of the table.
+ *
+ * States that loop on themselves over a whole run of bytes (whitespace, the tail
+ * of an identifier or number, a comment body) get a ScanRule, and transitions into
+ * them carry the ACCEL flag; the analyzer then lets `skip` jump over the rest of the
+ * run with SIMD instead of stepping through it one byte at a time.
+ *
+ * The arrays are read-only once built. A table compiled at runtime owns them and
+ * shares them between copies, and so does a table loaded from a file, whose arrays
+ * are the mapped file itself; a table wrapping arrays generated at build time (see
+ * static_dfa.h) only points at them.
+ */
+class CompiledDFA
+{
+    private:
+        struct Storage;
+
+        std::shared_ptr<const void> storage;        // keeps the arrays alive, if they are not static
+        const uint8_t *byte_class;
+        int num_states, num_classes, num_inner_states;
+        const uint16_t *table;
+        const int *attrs;
+        const ScanRule *accel;
+        const uint16_t *inner_states;
+        DirectScanner::ScanFunction direct_scan;
+
+    public:
+        enum : uint16_t {
+            ACCEPT = 0x8000,            // the byte ends the token; the rest is the start state's entry
+            FAIL = 0x4000,              // target state is of type FAIL
+            START = 0x2000,             // target state is of type START
+            ACCEL = 0x1000,             // target state has a ScanRule
+            STATE_MASK = 0x0fff,
+            NO_TRANSITION = 0xffff      // byte is not a symbol of the DFA
+        };
+        static constexpr int MAX_STATES = STATE_MASK;
+        static constexpr int MULTIBYTE = 256;       // byte_class index of multibyte UTF-8 characters
+
+        CompiledDFA();
+        CompiledDFA(const std::vector<State> &, const std::vector<InputSymbol> &, const std::vector<uint16_t> &);
+        CompiledDFA(const uint8_t *byte_class, int num_states, int num_classes, const uint16_t *table, const int *attrs,
+            const ScanRule *accel, const uint16_t *inner_states, int num_inner_states);
+        uint16_t next(uint16_t state, unsigned char ch) const
+        {
+            return table[state * num_classes + byte_class[ch]];
+        }
+        uint16_t next_multibyte(uint16_t state) const
+        {
+            return table[state * num_classes + byte_class[MULTIBYTE]];
+        }
+        int get_attr(uint16_t state) const
+        {
+            return attrs[state];
+        }
+        const unsigned char *skip(uint16_t state, const unsigned char *p, const unsigned char *end) const
+        {
+            return ByteScanner::skip(accel[state], p, end);
+        }
+        int get_num_states() const;
+        int get_num_classes() const;
+        int get_num_inner_states() const;
+        uint16_t get_inner_state(int) const;
+        const ScanRule &get_scan_rule(uint16_t) const;
+        int get_class(int byte) const;
+        uint16_t get_entry(uint16_t state, int cls) const;
+        uint32_t get_fingerprint() const;
+        int set_direct_scanner(const DirectScanner &);
+        int save(const std::string &path) const;
+        static CompiledDFA load(const std::string &path);
+
+        /**
+         * @brief Picks the ScanRule for a state from the set of bytes on which it stays
+         *        in itself, or returns a NONE rule if no rule matches that set exactly.
+         *        Skipping a run therefore always ends on the byte where the DFA would
+         *        have left the state anyway.
+         */
+        static constexpr ScanRule match_scan_rule(const std::array<bool, 256> &stay)
+        {
+            // UNTIL candidate: the alphabet bytes that leave the state
+            ScanRule until{ScanRule::UNTIL};
+            int num_leave = 0;
+            for(int b = 0; b < 256; b ++){
+                if(until.contains(b) && !stay[b]){
+                    if(num_leave ++ == 0){
+                        until.c1 = b;
+                    }
+                    until.c2 = b;
+                }
+            }
+            if(num_leave != 1 && num_leave != 2){
+                until = ScanRule{ScanRule::UNTIL};
+            }
+            for(ScanRule rule : {ScanRule{ScanRule::SPACE}, ScanRule{ScanRule::ALNUM}, ScanRule{ScanRule::DIGIT}, until}){
+                bool match = true;
+                for(int b = 0; b < 256 && match; b ++){
+                    match = rule.contains(b) == stay[b];
+                }
+                if(match){
+                    return rule;
+                }
+            }
+            return ScanRule();
+        }
+
+        template<class Emit>
+        ScanCursor scan(const unsigned char *data, size_t end, ScanCursor cursor, Emit &&emit) const;
+};
+
+/**
+ * @brief Runs the DFA over data[cursor.pos, end), starting in `cursor.state`.
+ *
+ * @param emit Called as `emit(first, last, attr)` for every token data[first, last)
+ *             that ends in an accepting state, IGNORE tokens included. Scanning goes
+ *             on while it returns true.
+ * @return The cursor after the last byte read. If a byte has no transition or leads
+ *         to a FAIL state, `status` says so and `pos` is that byte. A UTF-8 character
+ *         that `end` cuts off is not read: the scan stops RUNNING before it, with
+ *         `pos` short of `end`, so that it can go on once the rest is available.
+ *
+ * @details A token only ends once the byte after it has been read; that same lookup
+ *          also moves from the start state on the byte, as the first byte of the next
+ *          token. If `emit` returns false the scan stops before that byte instead, in
+ *          the start state. While the DFA is in a START state, `token_start` follows
+ *          the read position, so it always points at the first byte of the token in
+ *          progress. A byte without a transition that has the high bit set starts
+ *          a multibyte character, which is read whole with the entry of the
+ *          MULTIBYTE class; a malformed one is an unrecognized symbol. If a
+ *          DirectScanner is attached, the scan runs in its generated code instead.
+ */
+template<class Emit>
+ScanCursor CompiledDFA::scan(const unsigned char *data, size_t end, ScanCursor cursor, Emit &&emit) const
+{
+    if(direct_scan != nullptr){
+        using Sink = std::remove_reference_t<Emit>;
+        return direct_scan(data, end, cursor, [](void *context, size_t first, size_t last, int attr){
+            return (bool)(*static_cast<Sink *>(context))(first, last, attr);
+        }, (void *)&emit);
+    }
+    uint16_t state = cursor.state;
+    size_t pcur = cursor.pos, pstart = cursor.token_start;
+    while(pcur < end){
+        uint16_t entry = next(state, data[pcur]);
+        int width = 1;
+        if(__builtin_expect(entry == NO_TRANSITION, 0)){
+            width = ByteScanner::utf8_length(data + pcur, data + end);
+            if(width < 0){
+                break;
+            }
+            entry = width == 0 ? NO_TRANSITION : next_multibyte(state);
+            if(entry == NO_TRANSITION){
+                cursor.status = ScanCursor::UNRECOGNIZED_SYMBOL;
+                break;
+            }
+        }
+        if(entry & ACCEPT){
+            bool more = emit(pstart, pcur, attrs[state]);
+            pstart = pcur;
+            if(!more){
+                state = 0;
+                break;
+            }
+        }
+        state = entry & STATE_MASK;
+        if(entry & FAIL){
+            cursor.status = ScanCursor::FAILED;
+            cursor.error = attrs[state];
+            break;
+        }
+        pcur += width;
+        if(entry & ACCEL){
+            pcur = skip(state, data + pcur, data + end) - data;
+        }
+        if(entry & START){
+            pstart = pcur;
+        }
+    }
+    cursor.state = state;
+    cursor.pos = pcur;
+    cursor.token_start = pstart;
+    return cursor;
+}
+
+/**
+ * @brief A token produced by the LexicalAnalyzer, 12 bytes in total.
+ *
+ * `offset` and `length` locate the lexeme in the analyzed source. `kind` is the
+ * attribute of the accepting state (an index into `output_types`), and `id`
+ * numbers the distinct spellings of each kind densely from 0, so two tokens of
+ * the same kind have the same text exactly when they have the same id.
+ */
+struct Token
+{
+    uint32_t offset;
+    uint32_t length : 24;
+    uint32_t kind : 8;
+    uint32_t id;
+
+    static constexpr uint32_t MAX_LENGTH = (1u << 24) - 1;
+    static constexpr int MAX_KIND = (1 << 8) - 1;
+};
+
+/**
+ * @brief Maps strings to dense integer ids, storing each distinct string once.
+ *
+ * Views returned by `get_name` stay valid for the lifetime of the table. The keys
+ * of `ids` point into `names`, so a copy rebuilds them for its own strings.
+ */
+class InternTable
+{
+    private:
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, uint32_t> ids;
+
+    public:
+        InternTable() = default;
+        InternTable(const InternTable &);
+        InternTable(InternTable &&) = default;
+        InternTable &operator=(const InternTable &);
+        InternTable &operator=(InternTable &&) = default;
+
+        uint32_t intern(std::string_view);
+        std::string_view get_name(uint32_t) const;
+        size_t size() const;
+        int clear();
+};
+
+/**
+ * @brief A lexical error reported in recovery mode: the `length` bytes at `offset`
+ *        could not be lexed and were skipped. `status` is the code `analyze` would
+ *        have returned for it (UNRECOGNIZED_SYMBOL or UNKNOWN_ERROR), and `error` the
+ *        attribute of the FAIL state for the latter.
+ */
+struct Diagnostic
+{
+    size_t offset, length;
+    int status, error;
 };
 
 class LexicalAnalyzer
 {
     private:
-        DFA dfa;
-        std::vector<std::pair<std::string, int>> result;
+        CompiledDFA table;
+        std::vector<Token> result;
+        std::vector<InternTable> spellings;
         int error_code;
+        size_t consumed, base;
+        unsigned num_threads;
+        bool recovery, resyncing;
+        std::array<bool, 256> sync_bytes;
+        std::vector<Diagnostic> diagnostics;
+        KeywordSet keyword_set;
+        int identifier_kind;
+        std::string_view pull_window;       // state of next_token, see start()
+        SourceBuffer *pull_source;
+        std::string pull_tail;
+        ScanCursor pull_cursor;
+        int pull_status;
+
+        Token make_token(std::string_view, size_t, size_t, int);
+        void push_token(std::string_view, size_t, size_t, int);
+        ScanCursor scan_parallel(std::string_view, size_t);
+        size_t skip_to_sync(std::string_view, size_t);
+        size_t record_error(std::string_view, const ScanCursor &, bool more);
 
     public:
-        enum { OK = 0, UNRECOGNIZED_SYMBOL = -100, UNRECOGNIZED_IDENTIFIER, IGNORE, UNKNOWN_ERROR };
+        enum { OK = 0, UNRECOGNIZED_SYMBOL = -100, UNRECOGNIZED_IDENTIFIER, IGNORE, UNKNOWN_ERROR, END_OF_INPUT };
+        static constexpr size_t PARALLEL_CHUNK = 1 << 20;   // smallest input per thread
         
         LexicalAnalyzer(DFA);
+        LexicalAnalyzer(CompiledDFA);
         int set_dfa(DFA);
-        int analyze(std::string);
+        int set_dfa(CompiledDFA);
+        int set_threads(unsigned);
+        int set_recovery(std::string_view sync);
+        int set_keywords(KeywordSet, int identifier_kind);
+        int analyze(std::string_view, bool eof = true);
+        int analyze(SourceBuffer &);
+        int start(std::string_view);
+        int start(SourceBuffer &);
+        int next_token(Token &);
         int reset();
-        std::vector<std::pair<std::string, int>> get_result();
+        const CompiledDFA &get_dfa() const;
+        const std::vector<Token> &get_result() const;
+        std::string_view lexeme(const Token &) const;
+        const InternTable &get_spellings(int kind) const;
+        const std::vector<Diagnostic> &get_diagnostics() const;
         int get_error();
+        size_t get_consumed();
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A line and column in a source text, both counted from 1; columns count bytes.
+ */
+struct SourcePosition
+{
+    size_t line, column;
+};
+
+/**
+ * @brief Maps byte offsets of a text to lines and columns.
+ *
+ * Tokens and diagnostics only carry byte offsets, so lexing does no line bookkeeping
+ * at all. The line starts are found the first time an offset is located: the
+ * newlines are counted and then collected with ByteScanner, 16 or 32 bytes at a
+ * time, and every lookup after that is a binary search. A text that is never asked
+ * about costs nothing.
+ *
+ * The text is not copied and has to outlive the index. `locate` may be called from
+ * several threads; the first call builds the index for all of them.
+ *
+ * Input that is read in chunks and not kept (see SourceBuffer::set_line_index) is
+ * indexed as it streams through instead: an index made without a text starts empty,
+ * and `append` adds the line starts of each chunk.
+ */
+class LineIndex
+{
+    private:
+        std::string_view text;
+        size_t size;
+        bool streamed;
+        mutable std::vector<size_t> line_starts;
+        mutable std::once_flag built;
+
+        void build() const;
+
+    public:
+        LineIndex();
+        LineIndex(std::string_view text);
+        int append(std::string_view chunk);
+        SourcePosition locate(size_t offset) const;
+        size_t get_num_lines() const;
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "lexical_analysis.h"
+#include "lexer_generator.h"
 
 constexpr std::array<std::string_view, 8> keywords {
         "int", "double", "if", "then", "while", "do", "scanf", "printf"
@@ -34,6 +34,9 @@ constexpr std::array<std::string_view, 33> output_types{
         "INT", "DOUBLE",
         "NA", "NA" // note
     };
+// the kind of identifiers, after the keywords and operators
+constexpr int identifier_kind = keywords.size() + operators.size();
+
 constexpr std::array<std::string_view, 5> output_errs{
         "NA",
         "Malformed number: More than one decimal point in a floating point number.",
@@ -42,14 +45,18 @@ constexpr std::array<std::string_view, 5> output_errs{
         "Unrecognizable characters."
     };
 
+/**
+ * @brief The lexer of the language: LexRules written over the tables above, turned
+ *        into a DFA by LexerGenerator.
+ */
 class MakeDFA {
     private:
-        std::vector<std::map<char, int>> adj_keywords, adj_operators;
-        std::map<int, int> attr_keywords, attr_operators;
+        int built_states, minimized_states;
 
     public:
-        MakeDFA(int num_symbols = 0);
-        int insert_keyword(std::string, int);
-        int insert_operator(std::string, int);
-        DFA make_dfa();
+        MakeDFA();
+        static std::vector<InputSymbol> get_alphabet();
+        static std::vector<LexRule> get_rules(bool keyword_states = true);
+        DFA make_dfa(bool keyword_states = true);
+        std::pair<int, int> get_state_counts() const;
 };
@@ -0,0 +1,152 @@
+#include "source_buffer.h"
+#include "line_index.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Opens a byte source on an already open file descriptor.
+ *
+ * @param fd         The descriptor to read from. It is not closed by the SourceBuffer.
+ * @param chunk_size Initial size of the refill buffer when `fd` cannot be mapped.
+ *
+ * @details Regular files are mapped read-only and the whole file becomes the window,
+ *          with `at_eof()` already true. If `fd` is not a regular file or the mapping
+ *          fails, the first chunk is read into the refill buffer.
+ *
+ * @throws std::runtime_error If reading from `fd` fails.
+ */
+SourceBuffer::SourceBuffer(int fd, size_t chunk_size)
+    : fd(fd), map_base(nullptr), map_size(0), begin(0), end(0), eof(false), lines(nullptr)
+{
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)){
+        if(st.st_size == 0){
+            eof = true;
+            return;
+        }
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED){
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            map_base = (const char *)addr;
+            map_size = st.st_size;
+            end = map_size;
+            eof = true;
+            return;
+        }
+    }
+    buffer.resize(chunk_size > 0 ? chunk_size : CHUNK_SIZE);
+    refill();
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    if(map_base){
+        munmap((void *)map_base, map_size);
+    }
+}
+
+/**
+ * @brief Returns the bytes that are currently available and not yet consumed.
+ */
+std::string_view SourceBuffer::window() const
+{
+    const char *base = map_base ? map_base : buffer.data();
+    return std::string_view(base + begin, end - begin);
+}
+
+/**
+ * @brief Returns the whole input if the file is mapped, consumed bytes included, and
+ *        an empty view otherwise: a refilled input is not kept.
+ */
+std::string_view SourceBuffer::contents() const
+{
+    return std::string_view(map_base, map_size);
+}
+
+/**
+ * @brief Returns true if the window extends to the end of the input.
+ */
+bool SourceBuffer::at_eof() const
+{
+    return eof;
+}
+
+bool SourceBuffer::is_mapped() const
+{
+    return map_base != nullptr;
+}
+
+/**
+ * @brief Drops the first `n` bytes of the window; they will not be seen again.
+ */
+int SourceBuffer::consume(size_t n)
+{
+    begin += std::min(n, end - begin);
+    return 0;
+}
+
+/**
+ * @brief Makes more input available after the current window.
+ *
+ * @return 0 on success. Either at least one byte has been appended to the window,
+ *         or the end of the input has been reached and `at_eof()` is now true.
+ *
+ * @details The unconsumed tail of the window is moved to the front of the buffer.
+ *          If the tail fills the whole buffer (a token longer than the buffer), the
+ *          buffer is doubled so that the token can be completed.
+ *
+ * @throws std::runtime_error If reading from the file descriptor fails.
+ */
+int SourceBuffer::refill()
+{
+    if(eof){
+        return 0;
+    }
+    if(begin > 0){
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if(end == buffer.size()){
+        buffer.resize(buffer.size() * 2);
+    }
+    while(true){
+        ssize_t n = read(fd, buffer.data() + end, buffer.size() - end);
+        if(n > 0){
+            if(lines){
+                lines->append(std::string_view(buffer.data() + end, n));
+            }
+            end += n;
+            return 0;
+        }
+        if(n == 0){
+            eof = true;
+            return 0;
+        }
+        if(errno != EINTR){
+            throw std::runtime_error(std::string("SourceBuffer read failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+/**
+ * @brief Indexes the lines of the input into `lines` (made without a text) as it is
+ *        read, for input that is not mapped and so is not kept: the window read so
+ *        far is added at once and every refill adds what it reads. To be called
+ *        before anything is consumed.
+ */
+int SourceBuffer::set_line_index(LineIndex *lines)
+{
+    this->lines = lines;
+    if(lines){
+        lines->append(std::string_view(map_base ? map_base : buffer.data(), end));
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+class LineIndex;
+
+/**
+ * @brief Byte source for the lexer that avoids copying the whole input.
+ *
+ * A regular file is memory-mapped and exposed as a single window that already
+ * contains all of the input. Anything else (a pipe, a terminal) is read through
+ * a fixed-size refill buffer: the caller lexes the current window, drops the
+ * bytes it has fully consumed with `consume`, and calls `refill` to slide the
+ * unconsumed tail to the front and read more. The buffer only grows when a
+ * single token does not fit in it.
+ */
+class SourceBuffer
+{
+    private:
+        int fd;
+        const char *map_base;
+        size_t map_size;
+        std::vector<char> buffer;
+        size_t begin, end;
+        bool eof;
+        LineIndex *lines;
+
+    public:
+        static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+        SourceBuffer(int fd, size_t chunk_size = CHUNK_SIZE);
+        ~SourceBuffer();
+        SourceBuffer(const SourceBuffer &) = delete;
+        SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+        std::string_view window() const;
+        std::string_view contents() const;
+        bool at_eof() const;
+        bool is_mapped() const;
+        int consume(size_t);
+        int refill();
+        int set_line_index(LineIndex *);
+};
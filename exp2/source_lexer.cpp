@@ -0,0 +1,71 @@
+#include "source_lexer.h"
+#include "static_dfa.h"
+
+#include <stdexcept>
+
+static_assert(output_types[identifier_kind] == "IDENT" && output_types[identifier_kind + 1] == "INT"
+              && output_types[identifier_kind + 2] == "DOUBLE", "token kinds out of order");
+
+const int SourceLexer::NUM_KINDS = identifier_kind + 3;
+const int SourceLexer::IDENT = identifier_kind;
+const int SourceLexer::INT = identifier_kind + 1;
+const int SourceLexer::DOUBLE = identifier_kind + 2;
+
+SourceLexer::SourceLexer() : error_offset_(0) {
+    CompiledDFA dfa = get_static_dfa();
+    dfa.set_direct_scanner(lexer_direct_scanner);
+    analyzer_ = std::make_unique<LexicalAnalyzer>(dfa);
+    // recovery mode only to learn where the first error is, as `lex --all-errors`
+    std::string sync;
+    for(auto ch : empty_characters) {
+        sync += ch;
+    }
+    for(auto ch : operators_characters) {
+        sync += ch;
+    }
+    analyzer_->set_recovery(sync);
+}
+
+SourceLexer::~SourceLexer() = default;
+
+bool SourceLexer::Lex(std::string_view text, std::vector<SourceToken> &tokens) {
+    tokens.clear();
+    analyzer_->reset();
+    // as LexicalAnalyzer::analyze(SourceBuffer &), a last line without a newline is
+    // lexed from a copy that has one, so its last token ends
+    if(text.empty() || text.back() == '\n') {
+        analyzer_->analyze(text);
+    }else if(analyzer_->analyze(text, false) == LexicalAnalyzer::OK) {
+        std::string tail(text.substr(analyzer_->get_consumed()));
+        tail += '\n';
+        analyzer_->analyze(tail);
+    }
+    // a token cut off by the end of the text (an open comment) is dropped, which
+    // analyze reports as UNRECOGNIZED_IDENTIFIER; lex prints the tokens before it
+    if(!analyzer_->get_diagnostics().empty()) {
+        auto &diagnostic = analyzer_->get_diagnostics().front();
+        int code = diagnostic.status == LexicalAnalyzer::UNKNOWN_ERROR ? diagnostic.error : 4;
+        error_ = output_errs[code];
+        error_offset_ = diagnostic.offset;
+        return false;
+    }
+    tokens.reserve(analyzer_->get_result().size());
+    for(auto &token : analyzer_->get_result()) {
+        tokens.push_back({(int)token.kind, token.offset, token.length});
+    }
+    return true;
+}
+
+std::string_view SourceLexer::Spelling(int kind) {
+    if(kind >= 0 && kind < (int)keywords.size()) {
+        return keywords[kind];
+    }
+    if(kind >= (int)keywords.size() && kind < identifier_kind) {
+        return operators[kind - keywords.size()];
+    }
+    throw std::out_of_range("Token kind " + std::to_string(kind) + " has no fixed spelling");
+}
+
+std::string_view SourceLexer::KindName(int kind) {
+    return output_types.at(kind);
+}
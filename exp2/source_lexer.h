@@ -0,0 +1,52 @@
+// source_lexer.h
+#ifndef SOURCE_LEXER_H_
+#define SOURCE_LEXER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LexicalAnalyzer;
+
+// A token of the program: its kind in the lexer and where its lexeme is in the text
+struct SourceToken {
+    int kind;
+    uint32_t offset, length;
+};
+
+// The lexer of exp1 (LexicalAnalyzer on the static tables) run in the parser's
+// process. Only source_lexer.cpp includes the lexer headers, so their tables and
+// classes (State, DFA, ...) stay out of the grammar's way.
+class SourceLexer {
+private:
+    std::unique_ptr<LexicalAnalyzer> analyzer_;
+    std::string error_;
+    size_t error_offset_;
+
+public:
+    // the token kinds, and the ones that are not a fixed spelling
+    static const int NUM_KINDS, IDENT, INT, DOUBLE;
+
+    SourceLexer();
+    ~SourceLexer();
+
+    // Lexes the whole program into tokens; comments and whitespace are skipped.
+    // Returns false on a lexical error, see ErrorOffset and ErrorMessage.
+    bool Lex(std::string_view text, std::vector<SourceToken> &tokens);
+
+    size_t ErrorOffset() const {
+        return error_offset_;
+    }
+    const std::string &ErrorMessage() const {
+        return error_;
+    }
+
+    // the spelling of a keyword or operator kind
+    static std::string_view Spelling(int kind);
+    // the name lex prints for a kind
+    static std::string_view KindName(int kind);
+};
+
+#endif  // SOURCE_LEXER_H_
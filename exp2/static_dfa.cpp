@@ -0,0 +1,10 @@
+#include "static_dfa.h"
+
+// Evaluated by the compiler; get_static_dfa() and get_static_identifier_dfa() are
+// generated into direct_scanner.cpp.
+static constexpr KeywordHash<keywords.size()> keyword_hash(keywords);
+
+KeywordSet get_static_keywords()
+{
+    return keyword_hash.get();
+}
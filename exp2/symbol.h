@@ -8,6 +8,10 @@ class Symbol {
 public:
     std::string name, value;
     enum class Type { NONTERMINAL, TERMINAL } type;
+    // where a token starts in the program, for error messages
+    size_t offset = NO_OFFSET;
+
+    static constexpr size_t NO_OFFSET = -1;
 
     Symbol(const std::string& name, Type type)
         : name(name), type(type) {}
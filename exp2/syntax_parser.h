@@ -5,7 +5,16 @@
 // The classes in this file all depends on the Grammar
 
 #include <functional>
+#include <stdexcept>
 #include "lr1_parser.h"
+#include "line_index.h"
+
+// A program that is not in the language. what() is where and why, "line:column:
+// unexpected x", or empty if that is not known; the caller prints "Syntax Error".
+class SyntaxError : public std::runtime_error {
+public:
+    SyntaxError(const std::string &message) : std::runtime_error(message) {}
+};
 
 class SyntaxSymbol : public Symbol {
 public:
@@ -18,7 +27,8 @@ public:
     SyntaxSymbol(const Symbol &symbol) : Symbol(symbol) {}
 };
 
-class SymbolTableEntry {
+// An entry of the symbol table of the intermediate code
+class ICodeEntry {
 public:
     std::string name, type, value;
     int offset;
@@ -27,7 +37,7 @@ public:
 // Intermediate code
 class ICode {
 public:
-    std::vector<SymbolTableEntry> symbol_table;
+    std::vector<ICodeEntry> symbol_table;
     std::vector<std::array<std::string, 4>> quad;
 };
 
@@ -54,7 +64,7 @@ private:
             }
         }
         // 在符号表中创建新条目
-        SymbolTableEntry entry;
+        ICodeEntry entry;
         entry.name = name;
         entry.type = type;
         entry.offset = offset;
@@ -81,7 +91,7 @@ private:
     }
 
     int NewTemp_(std::string type){
-        SymbolTableEntry entry;
+        ICodeEntry entry;
         entry.name = "T" + std::to_string(temp_count_ ++) + "_" + type[0];
         entry.type = type.substr(0, 1) + "temp"; // 可以根据需要设置类型
         entry.offset = -1;    // 临时变量通常不分配实际的内存地址
@@ -111,8 +121,7 @@ private:
     }
 
     void SyntaxError_(){
-        std::cout << "Syntax Error";
-        exit(0);
+        throw SyntaxError("");
     }
 
     std::string TableName_(int idx){
@@ -132,6 +141,10 @@ private:
     std::map<Production, std::function<void()>> actions_;
 
 public:
+    // the actions capture this runner, so a copy would run them on the original
+    SyntaxAttrRunner(const SyntaxAttrRunner &) = delete;
+    SyntaxAttrRunner &operator=(const SyntaxAttrRunner &) = delete;
+
     SyntaxAttrRunner(const std::vector<Production> &p) {
         // PROG -> SUBPROG {}
         actions_[p[0]] = [&](){
@@ -657,15 +670,25 @@ private:
         std::cout << std::endl << std::endl;
     }
 
-    void SyntaxError_(){
-        std::cout << "Syntax Error";
-        exit(0);
+    void SyntaxError_(const Symbol &token, const LineIndex *lines){
+        // where, if the token's position is known
+        if(lines == nullptr) {
+            throw SyntaxError("");
+        }
+        if(token.offset == Symbol::NO_OFFSET) {
+            throw SyntaxError("unexpected end of input");
+        }
+        auto position = lines->locate(token.offset);
+        throw SyntaxError(std::to_string(position.line) + ":" + std::to_string(position.column) + ": unexpected "
+                          + (token.value.empty() ? token.name : token.value));
     }
 public:
     SyntaxParser(const LR1Table &table, const std::vector<Production> &p)
          : LR1Parser(table), attr_runner_(p) {}
 
-    ICode Parse(const std::vector<Symbol> &tokens) {
+    // `lines` indexes the program the tokens are from, for the position of a syntax error.
+    // Throws SyntaxError; the parser can parse the next program after it.
+    ICode Parse(const std::vector<Symbol> &tokens, const LineIndex *lines = nullptr) {
         // init stacks
         attr_runner_.Init();
         std::vector<int> state_stack;
@@ -685,7 +708,7 @@ public:
             auto it = table_.GetAction().find({state, token});
             if(it == table_.GetAction().end()) {
                 // std::cerr << "Error: no action for state " << state << " and token " << token.name << std::endl;
-                SyntaxError_();
+                SyntaxError_(token, lines);
             }
             auto action = it->second;
             // Do action
@@ -705,7 +728,7 @@ public:
                 auto it = table_.GetGoto().find({state, production.left});
                 if(it == table_.GetGoto().end()) {
                     // std::cerr << "Error: no goto for state " << state << " and symbol " << production.left.name << std::endl;
-                    SyntaxError_();
+                    SyntaxError_(token, lines);
                 }
                 state_stack.push_back(it->second);
             }else if(action.first == 'a') {
@@ -713,7 +736,7 @@ public:
                 break;
             }else{
                 // std::cerr << "Error: unknown action " << action.first << std::endl;
-                SyntaxError_();
+                SyntaxError_(token, lines);
             }
         }
         return attr_runner_.GetICode();
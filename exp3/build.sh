@@ -0,0 +1,4 @@
+#! /bin/bash
+
+g++ main.cc -o Main -std=c++17
+g++ ir_convert.cc -o ir_convert -std=c++17
@@ -0,0 +1,57 @@
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include "ir_file.h"
+
+// 中间代码文本格式和二进制格式 (ir_file.h) 互相转换，便于查看和调试
+//
+// ir_convert --to-binary [IN [OUT]]：文本格式 -> 二进制
+// ir_convert --to-text [IN [OUT]]：二进制 -> 文本格式
+// 省略 IN、OUT 或为 "-" 时使用标准输入、标准输出
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    std::string in_path = argc > 2 ? argv[2] : "-", out_path = argc > 3 ? argv[3] : "-";
+    if ((mode != "--to-binary" && mode != "--to-text") || argc > 4) {
+        std::cerr << "Usage: ir_convert --to-binary|--to-text [IN [OUT]]" << std::endl;
+        return 1;
+    }
+    try {
+        if (mode == "--to-binary") {
+            std::ifstream in;
+            if (in_path != "-") {
+                in.open(in_path);
+                if (!in) {
+                    throw std::runtime_error("Cannot open " + in_path);
+                }
+            }
+            IRBuilder builder;
+            builder.ReadText(in_path == "-" ? std::cin : in);
+            int out = out_path == "-" ? STDOUT_FILENO : open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out < 0) {
+                throw std::runtime_error("Cannot open " + out_path);
+            }
+            builder.Write(out);
+            if (out != STDOUT_FILENO) {
+                close(out);
+            }
+        } else {
+            int in = in_path == "-" ? STDIN_FILENO : open(in_path.c_str(), O_RDONLY);
+            if (in < 0) {
+                throw std::runtime_error("Cannot open " + in_path);
+            }
+            IRFile ir(in);
+            std::ofstream out;
+            if (out_path != "-") {
+                out.open(out_path);
+                if (!out) {
+                    throw std::runtime_error("Cannot open " + out_path);
+                }
+            }
+            ir.WriteText(out_path == "-" ? std::cout : out);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
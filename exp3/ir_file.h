@@ -0,0 +1,301 @@
+// ir_file.h
+#ifndef IR_FILE_H_
+#define IR_FILE_H_
+
+// 中间代码的二进制文件格式，供 exp2 和 exp3 分成两个进程时使用
+//
+// 内容与文本格式（exp2 的 Output 输出、exp3 的 main.cc 读入）相同：非临时变量的符号表、
+// 临时变量个数和四元式。文件由 IRFileHeader、IRSymbol[num_symbols]、IRQuad[num_quads]
+// 和字符串池依次组成，每段从 8 字节的倍数开始。字符串都以（偏移，长度）存放在池中，
+// 相同的字符串只存一次，其中可以有逗号、空格等任意字节。
+//
+// 写入时整个文件在内存中拼好，一次 write() 写出；读入时 mmap 整个文件，记录就地使用，
+// 不做任何解析。整数按写入机器的字节序存放；魔数、版本、字节序、各段大小在打开时检查，
+// 字符串的偏移和长度在访问时检查，所以损坏的文件不会读到映射以外。
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+struct IRFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t num_symbols, num_temps;
+    uint32_t num_quads, reserved;
+    uint64_t pool_size;
+    uint64_t size;      // 整个文件
+};
+
+// 字符串池中的一段
+struct IRString {
+    uint32_t offset, length;
+};
+
+// 符号表条目，type 为 0 (int) 或 1 (double)
+struct IRSymbol {
+    IRString name, value;
+    int32_t type, offset;
+};
+
+struct IRQuad {
+    IRString op, arg1, arg2, result;
+};
+
+static constexpr char IR_FILE_MAGIC[8] = {'I', 'C', 'O', 'D', 'E', 'I', 'R', '\n'};
+static constexpr uint32_t IR_FILE_VERSION = 1;
+static constexpr uint32_t IR_FILE_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(IRFileHeader) % 8 == 0, "the symbols must start aligned");
+
+// 各段的偏移和文件大小
+struct IRFileLayout {
+    size_t symbols, quads, pool, size;
+
+    IRFileLayout(size_t num_symbols, size_t num_quads, size_t pool_size){
+        auto align = [](size_t offset){
+            return (offset + 7) & ~(size_t)7;
+        };
+        symbols = sizeof(IRFileHeader);
+        quads = align(symbols + num_symbols * sizeof(IRSymbol));
+        pool = align(quads + num_quads * sizeof(IRQuad));
+        size = align(pool + pool_size);
+    }
+};
+
+// 构造二进制中间代码文件
+class IRBuilder {
+private:
+    std::vector<IRSymbol> symbols_;
+    std::vector<IRQuad> quads_;
+    std::string pool_;
+    std::deque<std::string> keys_;      // 键的存储，deque 中的元素不会移动
+    std::unordered_map<std::string_view, IRString> strings_;
+    uint32_t num_temps_ = 0;
+
+    IRString Intern_(std::string_view str){
+        auto it = strings_.find(str);
+        if(it != strings_.end()){
+            return it->second;
+        }
+        if(pool_.size() + str.size() > UINT32_MAX){
+            throw std::length_error("IR string pool exceeds 4 GiB");
+        }
+        IRString entry{(uint32_t)pool_.size(), (uint32_t)str.size()};
+        pool_.append(str);
+        keys_.emplace_back(str);
+        strings_.emplace(keys_.back(), entry);
+        return entry;
+    }
+
+public:
+    void AddSymbol(std::string_view name, int type, std::string_view value, int offset){
+        symbols_.push_back({Intern_(name), Intern_(value), type, offset});
+    }
+    void AddQuad(std::string_view op, std::string_view arg1, std::string_view arg2, std::string_view result){
+        quads_.push_back({Intern_(op), Intern_(arg1), Intern_(arg2), Intern_(result)});
+    }
+    void SetNumTemps(uint32_t num_temps){
+        num_temps_ = num_temps;
+    }
+
+    // 输入：in - 文本格式的中间代码
+    // 作用：读入文本格式，四元式按 exp3 的 ParseQuad 拆分
+    // 异常：std::invalid_argument - 文本格式不对
+    void ReadText(std::istream &in){
+        size_t n;
+        if(!(in >> n)){
+            throw std::invalid_argument("IR text has no symbol table");
+        }
+        for(size_t i = 0; i < n; i ++){
+            std::string name, value;
+            int type, offset;
+            if(!(in >> name >> type >> value >> offset)){
+                throw std::invalid_argument("IR text has a bad symbol table entry");
+            }
+            AddSymbol(name, type, value, offset);
+        }
+        if(!(in >> num_temps_ >> n)){
+            throw std::invalid_argument("IR text has no quadruples");
+        }
+        quads_.reserve(n);
+        for(size_t i = 0; i < n; i ++){
+            // 0: (op,arg1,arg2,result)
+            std::string index, quad;
+            if(!(in >> index >> quad) || quad.size() < 2 || quad.front() != '(' || quad.back() != ')'){
+                throw std::invalid_argument("IR text has a bad quadruple");
+            }
+            std::string_view rest(quad);
+            rest = rest.substr(1, rest.size() - 2);
+            std::string_view fields[4];
+            for(int k = 0; k < 3; k ++){
+                auto comma = rest.find(',');
+                if(comma == std::string_view::npos){
+                    throw std::invalid_argument("IR text has a quadruple with less than four fields");
+                }
+                fields[k] = rest.substr(0, comma);
+                rest = rest.substr(comma + 1);
+            }
+            fields[3] = rest;
+            AddQuad(fields[0], fields[1], fields[2], fields[3]);
+        }
+    }
+
+    // 输出：整个文件的内容
+    std::string Image() const {
+        IRFileLayout layout(symbols_.size(), quads_.size(), pool_.size());
+        std::string image(layout.size, '\0');
+        IRFileHeader header{};
+        std::memcpy(header.magic, IR_FILE_MAGIC, sizeof(header.magic));
+        header.version = IR_FILE_VERSION;
+        header.byte_order = IR_FILE_BYTE_ORDER;
+        header.num_symbols = symbols_.size();
+        header.num_temps = num_temps_;
+        header.num_quads = quads_.size();
+        header.pool_size = pool_.size();
+        header.size = layout.size;
+        std::memcpy(&image[0], &header, sizeof(header));
+        std::memcpy(&image[layout.symbols], symbols_.data(), symbols_.size() * sizeof(IRSymbol));
+        std::memcpy(&image[layout.quads], quads_.data(), quads_.size() * sizeof(IRQuad));
+        std::memcpy(&image[layout.pool], pool_.data(), pool_.size());
+        return image;
+    }
+
+    // 输入：fd - 已打开的文件描述符，不关闭
+    // 作用：一次 write() 写出整个文件（被信号打断或管道写满时接着写）
+    // 异常：std::runtime_error - 写入失败
+    void Write(int fd) const {
+        std::string image = Image();
+        for(size_t done = 0; done < image.size(); ){
+            ssize_t n = write(fd, image.data() + done, image.size() - done);
+            if(n < 0 && errno != EINTR){
+                throw std::runtime_error(std::string("Cannot write IR file: ") + std::strerror(errno));
+            }
+            done += n > 0 ? n : 0;
+        }
+    }
+};
+
+// 映射的二进制中间代码文件，记录就地读取
+class IRFile {
+private:
+    const char *base_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string buffer_;    // 不能映射的输入（管道）读到这里
+    IRFileHeader header_;
+    IRFileLayout layout_{0, 0, 0};
+
+    void Unmap_(){
+        if(mapped_){
+            munmap((void *)base_, size_);
+            mapped_ = false;
+        }
+    }
+
+public:
+    // 输入：fd - 已打开的文件描述符，不关闭
+    // 作用：映射普通文件，其他输入读到内存中，并检查文件头和各段大小
+    // 异常：std::runtime_error - 读取失败；std::invalid_argument - 不是这一版本的中间代码文件
+    explicit IRFile(int fd){
+        struct stat st;
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(addr != MAP_FAILED){
+                base_ = (const char *)addr;
+                size_ = st.st_size;
+                mapped_ = true;
+            }
+        }
+        if(!mapped_){
+            char chunk[1 << 16];
+            ssize_t n;
+            while((n = read(fd, chunk, sizeof(chunk))) != 0){
+                if(n < 0 && errno != EINTR){
+                    throw std::runtime_error(std::string("Cannot read IR file: ") + std::strerror(errno));
+                }
+                buffer_.append(chunk, n > 0 ? n : 0);
+            }
+            base_ = buffer_.data();
+            size_ = buffer_.size();
+        }
+        if(size_ < sizeof(header_) || std::memcmp(base_, IR_FILE_MAGIC, sizeof(IR_FILE_MAGIC)) != 0){
+            Unmap_();
+            throw std::invalid_argument("Not an IR file");
+        }
+        std::memcpy(&header_, base_, sizeof(header_));
+        std::string error;
+        if(header_.version != IR_FILE_VERSION){
+            error = "IR file has format version " + std::to_string(header_.version) + ", expected " + std::to_string(IR_FILE_VERSION);
+        }else if(header_.byte_order != IR_FILE_BYTE_ORDER){
+            error = "IR file was written with a different byte order";
+        }else{
+            layout_ = IRFileLayout(header_.num_symbols, header_.num_quads, header_.pool_size);
+            if(header_.size != size_ || layout_.size != size_){
+                error = "IR file is truncated or has trailing data";
+            }
+        }
+        if(!error.empty()){
+            Unmap_();
+            throw std::invalid_argument(error);
+        }
+    }
+    ~IRFile(){
+        Unmap_();
+    }
+    IRFile(const IRFile &) = delete;
+    IRFile &operator=(const IRFile &) = delete;
+
+    size_t NumSymbols() const {
+        return header_.num_symbols;
+    }
+    size_t NumTemps() const {
+        return header_.num_temps;
+    }
+    size_t NumQuads() const {
+        return header_.num_quads;
+    }
+    const IRSymbol &Symbol(size_t i) const {
+        return ((const IRSymbol *)(base_ + layout_.symbols))[i];
+    }
+    const IRQuad &Quad(size_t i) const {
+        return ((const IRQuad *)(base_ + layout_.quads))[i];
+    }
+    // 异常：std::out_of_range - 字符串超出字符串池
+    std::string_view String(IRString str) const {
+        if(str.offset > header_.pool_size || str.length > header_.pool_size - str.offset){
+            throw std::out_of_range("IR file has a string outside its pool");
+        }
+        return std::string_view(base_ + layout_.pool + str.offset, str.length);
+    }
+
+    // 输入：out - 输出流
+    // 作用：以文本格式输出，与 exp2 的 Output 相同
+    void WriteText(std::ostream &out) const {
+        out << NumSymbols() << "\n";
+        for(size_t i = 0; i < NumSymbols(); i ++){
+            auto &symbol = Symbol(i);
+            out << String(symbol.name) << " " << symbol.type << " " << String(symbol.value) << " " << symbol.offset << "\n";
+        }
+        out << NumTemps() << "\n";
+        out << NumQuads() << "\n";
+        for(size_t i = 0; i < NumQuads(); i ++){
+            auto &quad = Quad(i);
+            out << i << ": (" << String(quad.op) << "," << String(quad.arg1) << "," << String(quad.arg2) << "," << String(quad.result) << ")\n";
+        }
+    }
+};
+
+#endif  // IR_FILE_H_
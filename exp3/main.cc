@@ -1,4 +1,6 @@
+#include <fcntl.h>
 #include "quad_processor.h"
+#include "ir_file.h"
 
 // (R,-,-,TB0)
 Quadruple ParseQuad(std::string str){
@@ -50,14 +52,69 @@ std::vector<SymbolTableEntry> ReadSymbolTable() {
     return symbol_table;
 }
 
-int main() {
-    auto symbol_table = ReadSymbolTable();
-    int junk;
-    std::cin >> junk;
-    auto quadruples = ReadQuadruples();
+// 输入：ir - 二进制中间代码文件
+// 输出：符号表
+// 作用：从映射的文件中直接取出符号表，不做文本解析
+std::vector<SymbolTableEntry> ReadSymbolTable(const IRFile &ir) {
+    std::vector<SymbolTableEntry> symbol_table;
+    symbol_table.reserve(ir.NumSymbols());
+    for (size_t i = 0; i < ir.NumSymbols(); i ++) {
+        auto &symbol = ir.Symbol(i);
+        symbol_table.push_back(SymbolTableEntry(std::string(ir.String(symbol.name))));
+        symbol_table[i].type = symbol.type;
+        symbol_table[i].value = ir.String(symbol.value);
+        symbol_table[i].offset = symbol.offset;
+    }
+    return symbol_table;
+}
 
-    QuadProcessor processor(quadruples, symbol_table);
-    auto str = processor.ProcessQuadruples();
-    std::cout << str;
+std::vector<Quadruple> ReadQuadruples(const IRFile &ir) {
+    std::vector<Quadruple> quadruples;
+    quadruples.reserve(ir.NumQuads());
+    for (size_t i = 0; i < ir.NumQuads(); i ++) {
+        auto &quad = ir.Quad(i);
+        quadruples.push_back(Quadruple(std::string(ir.String(quad.op)), std::string(ir.String(quad.arg1)),
+                                       std::string(ir.String(quad.arg2)), std::string(ir.String(quad.result))));
+    }
+    return quadruples;
+}
+
+// Main：从标准输入读文本格式的中间代码
+// Main FILE：读 exp2 的 Main --ir-file 写出的二进制中间代码文件
+int main(int argc, char *argv[]) {
+    std::vector<SymbolTableEntry> symbol_table;
+    std::vector<Quadruple> quadruples;
+    if (argc > 1) {
+        int fd = open(argv[1], O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Cannot open " << argv[1] << std::endl;
+            return 1;
+        }
+        try {
+            IRFile ir(fd);
+            symbol_table = ReadSymbolTable(ir);
+            quadruples = ReadQuadruples(ir);
+        } catch (const std::exception &e) {
+            std::cerr << argv[1] << ": " << e.what() << std::endl;
+            close(fd);
+            return 1;
+        }
+        close(fd);
+    } else {
+        symbol_table = ReadSymbolTable();
+        int junk;
+        std::cin >> junk;
+        quadruples = ReadQuadruples();
+    }
+
+    // QuadProcessor 遇到无法翻译的中间代码时抛出异常
+    try {
+        QuadProcessor processor(quadruples, symbol_table);
+        auto str = processor.ProcessQuadruples();
+        std::cout << str;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -11,6 +11,7 @@
 #include <sstream>
 #include <cassert>
 #include <climits>
+#include <stdexcept>
 
 // 定义四元式结构
 class Quadruple {
@@ -195,6 +196,9 @@ private:
             // spill
             for(auto &entry : symbol_table_){
                 if(entry.live && !a_val_[entry.name].count(entry.name)){
+                    if(a_val_[entry.name].empty()){
+                        throw std::logic_error("Live variable " + entry.name + " is neither in memory nor in a register");
+                    }
                     std::string ra = *a_val_[entry.name].begin();
                     target_ << "mov " << GetMem_(entry.name) << ", " << ra << std::endl;
                 }
@@ -316,7 +320,9 @@ private:
         auto it = std::find_if(symbol_table_.begin(), symbol_table_.end(), [&](SymbolTableEntry &entry){
             return entry.name == name;
         });
-        assert(it != symbol_table_.end());
+        if(it == symbol_table_.end()){
+            throw std::invalid_argument("No memory for " + name);
+        }
         return "[ebp-" + std::to_string(it->offset) + "]";
     }
 
@@ -328,7 +334,7 @@ private:
         else if (op == "&&") return "and";
         else if (op == "||") return "or";
         else if (op == "!") return "not";
-        assert(0);
+        throw std::invalid_argument("Unsupported operator " + op);
     }
 
     std::string GetCmp_(std::string op){
@@ -338,7 +344,7 @@ private:
         else if (op == "!=") return "ne";
         else if (op == ">=") return "ge";
         else if (op == "<=") return "le";
-        assert(0);
+        throw std::invalid_argument("Unsupported comparison " + op);
     }
 
     // 输入：variable - 变量名, quadIndex - 四元式编号
@@ -394,8 +400,9 @@ private:
                 }
             }
         }
-        // spill
-        for(auto a : r_val_[Ri]){
+        // spill，循环中会从 r_val_[Ri] 删除，所以遍历副本
+        auto spilled = r_val_[Ri];
+        for(auto a : spilled){
             // check live
             auto it = std::find_if(symbol_table_.begin(), symbol_table_.end(), [&](SymbolTableEntry &entry){
                 return entry.name == a;
@@ -468,6 +475,10 @@ private:
             auto it = std::find_if(symbol_table_.begin(), symbol_table_.end(), [&](SymbolTableEntry &entry){
                 return entry.name == name;
             });
+            // 常数和 "-" 不在符号表中
+            if(it == symbol_table_.end()){
+                continue;
+            }
             it->use = u;
             it->live = l;
         }